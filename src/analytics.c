@@ -0,0 +1,677 @@
+/** \file analytics.c
+ *
+ * Statistics of the splits, gathered from the attempt log
+ *
+ * The attempts are read once, in the order they were made, and every statistic is
+ * updated as they go by, without keeping their times: the mean and variance with
+ * Welford's method and the percentiles with the P² algorithm. Only the segment times
+ * are picked from the lines of the log, without building JSON trees.
+ *
+ * The statistics are cached next to the log with the number of attempts they include,
+ * so only the attempts made since have to be read, one when a run is saved. The cache
+ * also has a hash of the title and the split titles, it's rebuilt when they change.
+ */
+#include "analytics.h"
+#include "history.h"
+
+#include <fcntl.h>
+#include <jansson.h>
+#include <limits.h>
+#include <linux/limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STATS_EXTENSION ".stats"
+#define STATS_MAGIC "LSST"
+#define STATS_VERSION 2
+#define TIME_STRING_MAX 64 // Longest time read from the log
+
+static const double quantile_values[LS_STATS_QUANTILES] = { 0.1, 0.5, 0.9 };
+
+static bool is_time(long long time)
+{
+    return time > 0 && time < LLONG_MAX;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void quantile_init(ls_quantile* quantile, double p)
+{
+    *quantile = (ls_quantile) {
+        .p = p,
+        .positions = { 1, 2, 3, 4, 5 },
+        .desired = { 1, 1 + 2 * p, 1 + 4 * p, 3 + 2 * p, 5 },
+    };
+}
+
+/**
+ * Predicts the height of a marker moved by one position, with a parabola through it and
+ * its neighbours.
+ */
+static double quantile_parabolic(const ls_quantile* quantile, int i, int step)
+{
+    const double* h = quantile->heights;
+    const double* n = quantile->positions;
+    return h[i] + step / (n[i + 1] - n[i - 1]) * ((n[i] - n[i - 1] + step) * (h[i + 1] - h[i]) / (n[i + 1] - n[i]) + (n[i + 1] - n[i] - step) * (h[i] - h[i - 1]) / (n[i] - n[i - 1]));
+}
+
+static void quantile_add(ls_quantile* quantile, double sample)
+{
+    double* h = quantile->heights;
+    double* n = quantile->positions;
+    if (quantile->count < 5) {
+        h[quantile->count++] = sample;
+        if (quantile->count == 5) {
+            qsort(h, 5, sizeof(double), compare_doubles);
+        }
+        return;
+    }
+
+    // Find the markers the sample falls between, extending the extremes if needed
+    int k = 0;
+    if (sample < h[0]) {
+        h[0] = sample;
+    } else if (sample >= h[4]) {
+        h[4] = sample;
+        k = 3;
+    } else {
+        while (sample >= h[k + 1]) {
+            k++;
+        }
+    }
+    for (int i = k + 1; i < 5; ++i) {
+        n[i]++;
+    }
+    const double p = quantile->p;
+    const double increments[5] = { 0, p / 2, p, (1 + p) / 2, 1 };
+    for (int i = 0; i < 5; ++i) {
+        quantile->desired[i] += increments[i];
+    }
+
+    // Move the middle markers that drifted from where they should be
+    for (int i = 1; i < 4; ++i) {
+        double drift = quantile->desired[i] - n[i];
+        if ((drift >= 1 && n[i + 1] - n[i] > 1) || (drift <= -1 && n[i - 1] - n[i] < -1)) {
+            int step = drift > 0 ? 1 : -1;
+            double height = quantile_parabolic(quantile, i, step);
+            if (height <= h[i - 1] || height >= h[i + 1]) {
+                height = h[i] + step * (h[i + step] - h[i]) / (n[i + step] - n[i]);
+            }
+            h[i] = height;
+            n[i] += step;
+        }
+    }
+    quantile->count++;
+}
+
+static long long quantile_value(const ls_quantile* quantile)
+{
+    if (!quantile->count) {
+        return LLONG_MAX;
+    }
+    if (quantile->count >= 5) {
+        return llround(quantile->heights[2]);
+    }
+    // Too few samples for the markers, use the closest one
+    double sorted[5];
+    memcpy(sorted, quantile->heights, quantile->count * sizeof(double));
+    qsort(sorted, quantile->count, sizeof(double), compare_doubles);
+    return llround(sorted[(int)(quantile->p * (quantile->count - 1) + 0.5)]);
+}
+
+static void add_segment(ls_split_stats* split, long long segment)
+{
+    if (!split->samples || segment < split->best) {
+        if (split->samples) {
+            split->golds++;
+        }
+        split->best = segment;
+    }
+    split->samples++;
+    double delta = (double)segment - split->mean;
+    split->mean += delta / split->samples;
+    split->m2 += delta * ((double)segment - split->mean);
+    for (int i = 0; i < LS_STATS_QUANTILES; ++i) {
+        quantile_add(&split->quantiles[i], (double)segment);
+    }
+}
+
+/**
+ * Adds an attempt to the statistics.
+ *
+ * @param stats The statistics.
+ * @param attempt The index record of the attempt.
+ * @param segments The segment times of the attempt, zero where they're missing.
+ */
+static void add_attempt(ls_stats* stats, const ls_attempt* attempt, const long long* segments)
+{
+    uint32_t reached = attempt->reached_split < stats->split_count ? attempt->reached_split + 1 : stats->split_count;
+    for (uint32_t i = 0; i < reached; ++i) {
+        stats->splits[i].reached++;
+        if (is_time(segments[i])) {
+            add_segment(&stats->splits[i], segments[i]);
+        }
+    }
+    if (!attempt->finished && attempt->reached_split < stats->split_count) {
+        stats->splits[attempt->reached_split].resets++;
+    }
+}
+
+static const char* skip_space(const char* p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Skips a JSON string.
+ *
+ * @return What follows the closing quote, or NULL if there's none.
+ */
+static const char* skip_string(const char* p)
+{
+    for (p++; *p; p++) {
+        if (*p == '\\') {
+            if (!*++p) {
+                return NULL;
+            }
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Skips a JSON value of any type.
+ *
+ * @return What follows the value, or NULL if it's malformed.
+ */
+static const char* skip_value(const char* p)
+{
+    int depth = 0;
+    do {
+        p = skip_space(p);
+        if (*p == '"') {
+            p = skip_string(p);
+            if (!p) {
+                return NULL;
+            }
+        } else if (*p == '{' || *p == '[') {
+            depth++;
+            p++;
+        } else if ((*p == '}' || *p == ']' || *p == ',' || *p == ':') && depth) {
+            depth -= *p == '}' || *p == ']';
+            p++;
+        } else if (*p && !strchr("}],:", *p)) {
+            while (*p && !strchr("{}[],:\" \t\r\n", *p)) {
+                p++;
+            }
+        } else {
+            return NULL;
+        }
+    } while (depth);
+    return p;
+}
+
+/**
+ * Reads the key of an object member.
+ *
+ * @return The start of the value, or NULL if it's malformed.
+ */
+static const char* member_key(const char* p, const char** key, size_t* length)
+{
+    if (*p != '"') {
+        return NULL;
+    }
+    *key = p + 1;
+    p = skip_string(p);
+    if (!p) {
+        return NULL;
+    }
+    *length = (size_t)(p - 1 - *key);
+    p = skip_space(p);
+    return *p == ':' ? skip_space(p + 1) : NULL;
+}
+
+/**
+ * Moves to the next member of an object or element of an array.
+ *
+ * @param close The character closing the object or array.
+ * @param[out] done Set if it's closed.
+ *
+ * @return The start of the next member, or NULL if it's malformed.
+ */
+static const char* next_member(const char* p, char close, bool* done)
+{
+    p = skip_space(p);
+    if (*p == close) {
+        *done = true;
+        return p + 1;
+    }
+    return *p == ',' ? skip_space(p + 1) : NULL;
+}
+
+static bool key_is(const char* key, size_t length, const char* name)
+{
+    return strlen(name) == length && strncmp(key, name, length) == 0;
+}
+
+/**
+ * Checks whether a JSON string is the expected one.
+ *
+ * @param p The opening quote of the string.
+ * @param end What follows the closing quote.
+ * @param expected The expected string.
+ */
+static bool string_is(const char* p, const char* end, const char* expected)
+{
+    size_t length = (size_t)(end - p - 2);
+    if (!memchr(p + 1, '\\', length)) {
+        return strlen(expected) == length && strncmp(p + 1, expected, length) == 0;
+    }
+    // Let jansson decode the escapes, titles rarely have any
+    json_t* string = json_loadb(p, (size_t)(end - p), JSON_DECODE_ANY, NULL);
+    bool equal = json_is_string(string) && strcmp(json_string_value(string), expected) == 0;
+    json_decref(string);
+    return equal;
+}
+
+/**
+ * Reads a time string of a saved run.
+ *
+ * @param p The start of the string.
+ * @param[out] time The time, left as it is if the string is too long.
+ *
+ * @return What follows the string, or NULL if it's malformed.
+ */
+static const char* parse_time(const char* p, long long* time)
+{
+    const char* value = p + 1;
+    p = skip_string(p);
+    if (!p) {
+        return NULL;
+    }
+    // Times are written without escapes
+    char string[TIME_STRING_MAX];
+    size_t value_length = (size_t)(p - 1 - value);
+    if (value_length < sizeof(string)) {
+        memcpy(string, value, value_length);
+        string[value_length] = '\0';
+        *time = ls_time_value(string);
+    }
+    return p;
+}
+
+/**
+ * Reads the split and segment times of a split of a saved run.
+ *
+ * @param p The start of the split.
+ * @param title The title of the split in the game, NULL if any title fits.
+ * @param[out] time The split time, zero if it's missing.
+ * @param[out] segment The segment time, zero if it's missing.
+ * @param[out] matches Cleared if the split has another title.
+ *
+ * @return What follows the split, or NULL if it's malformed.
+ */
+static const char* parse_split(const char* p, const char* title, long long* time, long long* segment, bool* matches)
+{
+    *time = 0;
+    *segment = 0;
+    bool title_found = false;
+    if (*p != '{') {
+        return NULL;
+    }
+    p = skip_space(p + 1);
+    bool done = *p == '}';
+    if (done) {
+        p++;
+    }
+    while (!done) {
+        const char* key;
+        size_t length;
+        p = member_key(p, &key, &length);
+        if (!p) {
+            return NULL;
+        }
+        if (key_is(key, length, "title") && *p == '"') {
+            const char* value = p;
+            p = skip_string(p);
+            if (!p) {
+                return NULL;
+            }
+            title_found = true;
+            if (title && !string_is(value, p, title)) {
+                *matches = false;
+            }
+        } else if (key_is(key, length, "time") && *p == '"') {
+            p = parse_time(p, time);
+        } else if (key_is(key, length, "segment") && *p == '"') {
+            p = parse_time(p, segment);
+        } else {
+            p = skip_value(p);
+        }
+        if (!p || !(p = next_member(p, '}', &done))) {
+            return NULL;
+        }
+    }
+    if (title && !title_found) {
+        *matches = false;
+    }
+    return p;
+}
+
+/**
+ * Reads the split and segment times of a saved run from its line of the log.
+ *
+ * Like ls_history_run_matches, the run must have the title and the splits of the game.
+ *
+ * @param line The run, as saved in the log.
+ * @param game The game.
+ * @param[out] splits The split times, zero where they're missing. Can be NULL.
+ * @param[out] segments The segment times, zero where they're missing.
+ *
+ * @return False if the run can't be read or was made with other splits.
+ */
+bool ls_stats_parse_run(const char* line, const ls_game* game, long long* splits, long long* segments)
+{
+    int count = game->split_count;
+    int found = -1;
+    bool matches = true;
+    bool title_found = false;
+    const char* p = skip_space(line);
+    if (*p != '{') {
+        return false;
+    }
+    p = skip_space(p + 1);
+    bool done = *p == '}';
+    while (!done) {
+        const char* key;
+        size_t length;
+        p = member_key(p, &key, &length);
+        if (!p) {
+            return false;
+        }
+        if (key_is(key, length, "title")) {
+            const char* value = p;
+            p = skip_value(p);
+            title_found = true;
+            if (p && (!game->title || *value != '"' || !string_is(value, p, game->title))) {
+                matches = false;
+            }
+        } else if (key_is(key, length, "splits") && *p == '[') {
+            found = 0;
+            p = skip_space(p + 1);
+            bool last = *p == ']';
+            if (last) {
+                p++;
+            }
+            while (!last) {
+                long long time;
+                long long segment;
+                const char* title = found >= 0 && found < count ? game->split_titles[found] : NULL;
+                p = parse_split(p, title, &time, &segment, &matches);
+                if (!p || !(p = next_member(p, ']', &last))) {
+                    return false;
+                }
+                if (found < count) {
+                    if (splits) {
+                        splits[found] = time;
+                    }
+                    segments[found] = segment;
+                }
+                found++;
+            }
+        } else {
+            p = skip_value(p);
+        }
+        if (!p || !(p = next_member(p, '}', &done))) {
+            return false;
+        }
+    }
+    if (game->title && !title_found) {
+        matches = false;
+    }
+    return matches && found == count;
+}
+
+static void stats_init(ls_stats* stats, int split_count)
+{
+    memset(stats, 0, sizeof(ls_stats) + split_count * sizeof(ls_split_stats));
+    stats->split_count = (uint32_t)split_count;
+    for (int i = 0; i < split_count; ++i) {
+        for (int j = 0; j < LS_STATS_QUANTILES; ++j) {
+            quantile_init(&stats->splits[i].quantiles[j], quantile_values[j]);
+        }
+    }
+}
+
+static uint64_t hash_string(uint64_t hash, const char* string)
+{
+    // Missing strings hash like empty ones, the terminator separates them
+    for (const char* c = string ? string : ""; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 0x100000001b3ULL;
+    }
+    return (hash ^ 0xff) * 0x100000001b3ULL;
+}
+
+/**
+ * Hashes the title and the split titles of a game, which the cached statistics are for.
+ */
+static uint64_t game_hash(const ls_game* game)
+{
+    uint64_t hash = hash_string(0xcbf29ce484222325ULL, game->title); // FNV-1a
+    for (int i = 0; i < game->split_count; ++i) {
+        hash = hash_string(hash, game->split_titles[i]);
+    }
+    return hash;
+}
+
+/**
+ * Reads the cached statistics of a game.
+ *
+ * @return False if there's no usable cache.
+ */
+static bool stats_read(const char* path, ls_stats* stats, const ls_game* game)
+{
+    int split_count = game->split_count;
+    FILE* file = fopen(path, "rbe");
+    if (!file) {
+        return false;
+    }
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;
+    bool valid = fread(magic, sizeof(magic), 1, file) == 1
+        && memcmp(magic, STATS_MAGIC, sizeof(magic)) == 0
+        && fread(&version, sizeof(version), 1, file) == 1
+        && version == STATS_VERSION
+        && fread(&hash, sizeof(hash), 1, file) == 1
+        && hash == game_hash(game)
+        && fread(stats, sizeof(ls_stats), 1, file) == 1
+        && stats->split_count == (uint32_t)split_count
+        && fread(stats->splits, sizeof(ls_split_stats), split_count, file) == (size_t)split_count;
+    fclose(file);
+    return valid;
+}
+
+/**
+ * Writes the statistics of a game to its cache, replacing it at once.
+ *
+ * @return Non-zero on error.
+ */
+static int stats_write(const char* path, const ls_stats* stats, const ls_game* game)
+{
+    char temp_path[PATH_MAX];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        return 1;
+    }
+    FILE* file = fopen(temp_path, "wbe");
+    if (!file) {
+        printf("[analytics] Can't write %s\n", temp_path);
+        return 1;
+    }
+    uint32_t version = STATS_VERSION;
+    uint64_t hash = game_hash(game);
+    bool written = fwrite(STATS_MAGIC, 4, 1, file) == 1
+        && fwrite(&version, sizeof(version), 1, file) == 1
+        && fwrite(&hash, sizeof(hash), 1, file) == 1
+        && fwrite(stats, sizeof(ls_stats) + stats->split_count * sizeof(ls_split_stats), 1, file) == 1;
+    if (fclose(file) || !written || rename(temp_path, path)) {
+        printf("[analytics] Can't write %s\n", path);
+        unlink(temp_path);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * What is needed to add the attempts read from the log.
+ */
+typedef struct StatsScan {
+    const ls_game* game;
+    ls_stats* stats;
+    long long* segments; /*!< The segment times of the attempt being read */
+    int added; /*!< Number of attempts read */
+} StatsScan;
+
+static void scan_attempt(const ls_attempt* attempt, const char* line, void* data)
+{
+    StatsScan* scan = data;
+    ls_stats* stats = scan->stats;
+    // Runs made before the splits were changed don't fit, they are only counted
+    if (ls_stats_parse_run(line, scan->game, NULL, scan->segments)) {
+        add_attempt(stats, attempt, scan->segments);
+    }
+    stats->attempts = attempt->id;
+    scan->added++;
+}
+
+/**
+ * Adds the attempts of the log that aren't in the statistics yet, and caches them.
+ *
+ * @param game The game.
+ * @param stats Its statistics.
+ *
+ * @return The number of attempts added.
+ */
+int ls_stats_update(const ls_game* game, ls_stats* stats)
+{
+    StatsScan scan = { game, stats, NULL, 0 };
+    if (stats->attempts > ls_history_count(game->path)) {
+        // The log was replaced, start over
+        stats_init(stats, (int)stats->split_count);
+    }
+    scan.segments = malloc(stats->split_count * sizeof(long long));
+    if (!scan.segments) {
+        return 0;
+    }
+    ls_history_foreach_line(game->path, stats->attempts + 1, scan_attempt, &scan);
+    free(scan.segments);
+
+    char path[PATH_MAX];
+    if (scan.added && ls_history_file_path(game->path, STATS_EXTENSION, path)) {
+        stats_write(path, stats, game);
+    }
+    return scan.added;
+}
+
+/**
+ * Loads the statistics of a game from its cache, adding the attempts made since.
+ *
+ * @param game The game, with its splits loaded.
+ *
+ * @return The statistics, to be freed, or NULL if the game has no splits or the memory
+ * couldn't be allocated.
+ */
+ls_stats* ls_stats_load(const ls_game* game)
+{
+    if (game->split_count <= 0) {
+        return NULL;
+    }
+    ls_stats* stats = malloc(sizeof(ls_stats) + game->split_count * sizeof(ls_split_stats));
+    if (!stats) {
+        return NULL;
+    }
+    char path[PATH_MAX];
+    if (!ls_history_file_path(game->path, STATS_EXTENSION, path) || !stats_read(path, stats, game)) {
+        stats_init(stats, game->split_count);
+    }
+    ls_stats_update(game, stats);
+    return stats;
+}
+
+/**
+ * Gets the standard deviation of the segment times of a split.
+ */
+double ls_stats_stddev(const ls_split_stats* split)
+{
+    return split->samples > 1 ? sqrt(split->m2 / (split->samples - 1)) : 0;
+}
+
+/**
+ * Gets an estimated percentile of the segment times of a split.
+ *
+ * @param split The statistics of the split.
+ * @param quantile Which one, 0 to 2 for the 10th, 50th and 90th percentiles.
+ *
+ * @return The segment time, or LLONG_MAX if there's none.
+ */
+long long ls_stats_quantile(const ls_split_stats* split, int quantile)
+{
+    return quantile_value(&split->quantiles[quantile]);
+}
+
+static void dump_time(FILE* out, long long time)
+{
+    char string[256];
+    if (is_time(time)) {
+        ls_time_string(string, time);
+    } else {
+        strcpy(string, "-");
+    }
+    fprintf(out, " %10s", string);
+}
+
+/**
+ * Prints the statistics of a game.
+ *
+ * @param game The game.
+ * @param stats Its statistics, NULL if there are none.
+ * @param out Where to print them.
+ */
+void ls_stats_dump(const ls_game* game, const ls_stats* stats, FILE* out)
+{
+    if (!stats) {
+        fprintf(out, "No split statistics\n");
+        return;
+    }
+    fprintf(out, "Split statistics of %s (%u attempts)\n", game->title ? game->title : game->path, stats->attempts);
+    fprintf(out, "  %-20s %7s %7s %7s %10s %10s %10s %10s %10s\n",
+        "split", "reached", "resets", "golds", "mean", "stddev", "p10", "p50", "p90");
+    for (uint32_t i = 0; i < stats->split_count; ++i) {
+        const ls_split_stats* split = &stats->splits[i];
+        fprintf(out, "  %-20.20s %7u %6.1f%% %6.1f%%",
+            game->split_titles[i] ? game->split_titles[i] : "",
+            split->reached,
+            split->reached ? 100.0 * split->resets / split->reached : 0,
+            split->samples ? 100.0 * split->golds / split->samples : 0);
+        dump_time(out, split->samples ? llround(split->mean) : LLONG_MAX);
+        dump_time(out, llround(ls_stats_stddev(split)));
+        for (int j = 0; j < LS_STATS_QUANTILES; ++j) {
+            dump_time(out, ls_stats_quantile(split, j));
+        }
+        fprintf(out, "\n");
+    }
+    fflush(out);
+}
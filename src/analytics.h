@@ -0,0 +1,53 @@
+#pragma once
+
+#include "timer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LS_STATS_QUANTILES 3 // The 10th, 50th and 90th percentiles
+
+/**
+ * Online estimator of a quantile, with the P² algorithm.
+ *
+ * Five markers follow the minimum, the maximum, the quantile and the quantiles halfway
+ * to the extremes. Their heights are adjusted with each sample, so nothing is kept.
+ */
+typedef struct ls_quantile {
+    double p; /*!< The quantile estimated, between 0 and 1 */
+    uint32_t count; /*!< Number of samples */
+    uint32_t reserved;
+    double heights[5]; /*!< Heights of the markers, the first samples until there are five */
+    double positions[5]; /*!< Positions of the markers, starting at 1 */
+    double desired[5]; /*!< Where the markers should be */
+} ls_quantile;
+
+/**
+ * Statistics of a split, gathered from the attempt log.
+ */
+typedef struct ls_split_stats {
+    uint32_t reached; /*!< Attempts that started the segment */
+    uint32_t resets; /*!< Attempts reset during the segment */
+    uint32_t samples; /*!< Attempts that have a time for the segment */
+    uint32_t golds; /*!< Segment times better than all the ones before them */
+    int64_t best; /*!< Best segment time */
+    double mean; /*!< Mean segment time */
+    double m2; /*!< Sum of the squared distances to the mean, for the variance */
+    ls_quantile quantiles[LS_STATS_QUANTILES]; /*!< Estimated percentiles of the segment times */
+} ls_split_stats;
+
+/**
+ * Statistics of all the splits of a game.
+ */
+typedef struct ls_stats {
+    uint32_t split_count;
+    uint32_t attempts; /*!< Number of attempts of the log included */
+    ls_split_stats splits[]; /*!< The statistics of each split */
+} ls_stats;
+
+ls_stats* ls_stats_load(const ls_game* game);
+bool ls_stats_parse_run(const char* line, const ls_game* game, long long* splits, long long* segments);
+int ls_stats_update(const ls_game* game, ls_stats* stats);
+double ls_stats_stddev(const ls_split_stats* split);
+long long ls_stats_quantile(const ls_split_stats* split, int quantile);
+void ls_stats_dump(const ls_game* game, const ls_stats* stats, FILE* out);
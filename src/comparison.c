@@ -0,0 +1,282 @@
+/** \file comparison.c
+ *
+ * Comparisons the timer can compare the run against
+ *
+ * Apart from the personal best, they are computed from the attempt log when the split
+ * file loads, and stored as arrays of split and segment times next to the ones of the
+ * personal best. Switching between them only changes which arrays the timer uses. The
+ * log is read with the line scanner of the statistics, without building JSON trees.
+ *
+ * The best segments and the latest run are kept up to date as runs are saved, the other
+ * ones are computed again the next time the split file loads.
+ */
+#include "comparison.h"
+#include "analytics.h"
+#include "history.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BALANCED_ITERATIONS 32 // Steps of the search for the balanced percentile
+
+/**
+ * The segment times of a split, found in the attempt log.
+ */
+typedef struct SegmentSamples {
+    long long* values;
+    int count;
+    int capacity;
+} SegmentSamples;
+
+static const char* comparison_names[LS_COMPARISON_COUNT] = {
+    [LS_COMPARISON_PB] = "Personal Best",
+    [LS_COMPARISON_BEST_SEGMENTS] = "Best Segments",
+    [LS_COMPARISON_AVERAGE] = "Average Segments",
+    [LS_COMPARISON_MEDIAN] = "Median Segments",
+    [LS_COMPARISON_LATEST] = "Latest Run",
+    [LS_COMPARISON_BALANCED] = "Balanced PB",
+};
+
+/**
+ * Gets the name of a comparison, as shown to the user.
+ */
+const char* ls_comparison_name(ls_comparison comparison)
+{
+    return comparison_names[comparison];
+}
+
+static bool is_time(long long time)
+{
+    return time > 0 && time < LLONG_MAX;
+}
+
+static bool add_sample(SegmentSamples* samples, long long value)
+{
+    if (samples->count == samples->capacity) {
+        int capacity = samples->capacity ? samples->capacity * 2 : 16;
+        long long* values = realloc(samples->values, capacity * sizeof(long long));
+        if (!values) {
+            return false;
+        }
+        samples->values = values;
+        samples->capacity = capacity;
+    }
+    samples->values[samples->count++] = value;
+    return true;
+}
+
+static int compare_times(const void* a, const void* b)
+{
+    long long x = *(const long long*)a;
+    long long y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Turns segment times into split times, stopping at the first missing segment.
+ */
+static void accumulate(const long long* segments, long long* splits, int count)
+{
+    long long total = 0;
+    for (int i = 0; i < count; ++i) {
+        if (total == LLONG_MAX || !is_time(segments[i])) {
+            total = LLONG_MAX;
+        } else {
+            total += segments[i];
+        }
+        splits[i] = total;
+    }
+}
+
+/**
+ * Gets a percentile of sorted samples, interpolating between the closest ones.
+ */
+static long long percentile(const SegmentSamples* samples, double p)
+{
+    double position = p * (samples->count - 1);
+    int index = (int)position;
+    if (index >= samples->count - 1) {
+        return samples->values[samples->count - 1];
+    }
+    double fraction = position - index;
+    return samples->values[index] + (long long)(fraction * (double)(samples->values[index + 1] - samples->values[index]));
+}
+
+static long long percentile_sum(const SegmentSamples* samples, int count, double p)
+{
+    long long sum = 0;
+    for (int i = 0; i < count; ++i) {
+        sum += percentile(&samples[i], p);
+    }
+    return sum;
+}
+
+/**
+ * Computes the balanced personal best: every segment takes the same percentile of its
+ * history, chosen so the segments add up to the personal best.
+ *
+ * @return False if there's not enough history, leaving the segments untouched.
+ */
+static bool balance(const ls_game* game, const SegmentSamples* samples, long long* segments)
+{
+    long long target = game->split_count ? game->split_times[game->split_count - 1] : 0;
+    if (!is_time(target)) {
+        return false;
+    }
+    for (int i = 0; i < game->split_count; ++i) {
+        if (!samples[i].count) {
+            return false;
+        }
+    }
+
+    double low = 0, high = 1;
+    for (int i = 0; i < BALANCED_ITERATIONS; ++i) {
+        double middle = (low + high) / 2;
+        if (percentile_sum(samples, game->split_count, middle) < target) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    for (int i = 0; i < game->split_count; ++i) {
+        segments[i] = percentile(&samples[i], high);
+    }
+    return true;
+}
+
+/**
+ * What is gathered from the attempt log.
+ */
+typedef struct HistoryScan {
+    ls_game* game;
+    SegmentSamples* samples; /*!< The segment times of each split */
+    long long* splits; /*!< The split times of the attempt being read */
+    long long* segments; /*!< The segment times of the attempt being read */
+} HistoryScan;
+
+/**
+ * Adds the segments of an attempt to the samples, and makes it the latest run.
+ */
+static void collect_run(const ls_attempt* attempt, const char* line, void* data)
+{
+    HistoryScan* scan = data;
+    ls_game* game = scan->game;
+    if (!ls_stats_parse_run(line, game, scan->splits, scan->segments)) {
+        return;
+    }
+    for (int i = 0; i < game->split_count; ++i) {
+        long long time = scan->splits[i];
+        long long segment = scan->segments[i];
+        if (is_time(segment)) {
+            add_sample(&scan->samples[i], segment);
+        }
+        // The log is in the order the attempts were made, the last one is the latest
+        game->comparison_splits[LS_COMPARISON_LATEST][i] = is_time(time) ? time : LLONG_MAX;
+        game->comparison_segments[LS_COMPARISON_LATEST][i] = is_time(segment) ? segment : LLONG_MAX;
+    }
+}
+
+/**
+ * Reads the attempt log of the game, and computes the comparisons from it.
+ *
+ * The personal best comparison uses the split and segment times of the game. The ones
+ * that can't be computed, because there's no history yet, are left empty.
+ *
+ * @param game The game, with its splits loaded.
+ *
+ * @return Non-zero if the memory couldn't be allocated.
+ */
+int ls_game_load_comparisons(ls_game* game)
+{
+    int count = game->split_count;
+    game->comparison_splits[LS_COMPARISON_PB] = game->split_times;
+    game->comparison_segments[LS_COMPARISON_PB] = game->segment_times;
+    if (!count) {
+        return 0;
+    }
+
+    // One block for the split and segment times of all the computed comparisons
+    game->comparison_data = malloc(2 * (LS_COMPARISON_COUNT - 1) * count * sizeof(long long));
+    SegmentSamples* samples = calloc(count, sizeof(SegmentSamples));
+    long long* times = malloc(2 * count * sizeof(long long));
+    if (!game->comparison_data || !samples || !times) {
+        free(samples);
+        free(times);
+        return 1;
+    }
+    for (int i = 0; i < 2 * (LS_COMPARISON_COUNT - 1) * count; ++i) {
+        game->comparison_data[i] = LLONG_MAX;
+    }
+    for (int c = 1; c < LS_COMPARISON_COUNT; ++c) {
+        game->comparison_splits[c] = game->comparison_data + 2 * (c - 1) * count;
+        game->comparison_segments[c] = game->comparison_splits[c] + count;
+    }
+
+    HistoryScan scan = { game, samples, times, times + count };
+    ls_history_foreach_line(game->path, 1, collect_run, &scan);
+    free(times);
+
+    for (int i = 0; i < count; ++i) {
+        game->comparison_segments[LS_COMPARISON_BEST_SEGMENTS][i] = game->best_segments[i];
+        if (samples[i].count) {
+            long long sum = 0;
+            for (int j = 0; j < samples[i].count; ++j) {
+                sum += samples[i].values[j];
+            }
+            game->comparison_segments[LS_COMPARISON_AVERAGE][i] = sum / samples[i].count;
+            qsort(samples[i].values, samples[i].count, sizeof(long long), compare_times);
+            game->comparison_segments[LS_COMPARISON_MEDIAN][i] = percentile(&samples[i], 0.5);
+        }
+    }
+    if (!balance(game, samples, game->comparison_segments[LS_COMPARISON_BALANCED])) {
+        memcpy(game->comparison_segments[LS_COMPARISON_BALANCED], game->segment_times, count * sizeof(long long));
+    }
+    for (int c = 1; c < LS_COMPARISON_COUNT; ++c) {
+        if (c != LS_COMPARISON_LATEST) {
+            accumulate(game->comparison_segments[c], game->comparison_splits[c], count);
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        free(samples[i].values);
+    }
+    free(samples);
+    return 0;
+}
+
+/**
+ * Makes the best segments comparison use the best segments of the game, after they
+ * were updated with a run.
+ *
+ * @param game The game.
+ */
+void ls_game_update_best_comparison(ls_game* game)
+{
+    if (!game->comparison_data) {
+        return;
+    }
+    long long* segments = game->comparison_segments[LS_COMPARISON_BEST_SEGMENTS];
+    memcpy(segments, game->best_segments, game->split_count * sizeof(long long));
+    accumulate(segments, game->comparison_splits[LS_COMPARISON_BEST_SEGMENTS], game->split_count);
+}
+
+/**
+ * Makes a run that was just saved to the attempt log the latest run comparison.
+ *
+ * @param game The game.
+ * @param timer The timer of the run.
+ */
+void ls_game_update_latest_comparison(ls_game* game, const ls_timer* timer)
+{
+    if (!game->comparison_data) {
+        return;
+    }
+    for (int i = 0; i < game->split_count; ++i) {
+        // The same times as the ones saved, splits not reached have none
+        bool done = i < timer->curr_split && is_time(timer->split_times[i]);
+        game->comparison_splits[LS_COMPARISON_LATEST][i] = done ? timer->split_times[i] : LLONG_MAX;
+        game->comparison_segments[LS_COMPARISON_LATEST][i] = done && is_time(timer->segment_times[i]) ? timer->segment_times[i] : LLONG_MAX;
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "timer.h"
+
+int ls_game_load_comparisons(ls_game* game);
+void ls_game_update_best_comparison(ls_game* game);
+void ls_game_update_latest_comparison(ls_game* game, const ls_timer* timer);
+const char* ls_comparison_name(ls_comparison comparison);
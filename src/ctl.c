@@ -27,6 +27,8 @@ void print_help()
     printf("  unsplit       - Unsplit the timer\n");
     printf("  skipsplit     - Skip the current split\n");
     printf("  exit          - Closes LibreSplit\n");
+    printf("  profile       - Print the auto splitter profile on LibreSplit's output\n");
+    printf("  stats         - Print the split statistics on LibreSplit's output\n");
     printf("  help          - Show this help message\n");
 }
 
@@ -121,6 +123,10 @@ int main(int argc, char* argv[])
         success = sendToLibreSplit(CTL_CMD_SKIP);
     } else if (strcmp(cmd, "exit") == 0) {
         success = sendToLibreSplit(CTL_CMD_EXIT);
+    } else if (strcmp(cmd, "profile") == 0) {
+        success = sendToLibreSplit(CTL_CMD_PROFILE_DUMP);
+    } else if (strcmp(cmd, "stats") == 0) {
+        success = sendToLibreSplit(CTL_CMD_STATS_DUMP);
     } else {
         fprintf(stderr, "Unknown command: %s\n", cmd);
         fprintf(stderr, "Try 'help' for a list of valid commands.\n");
@@ -2,6 +2,8 @@
 #include "src/gui/component/components.h"
 #include "src/settings/settings.h"
 
+#define RENDER_INTERVAL_MS (1000 / 30) // Redraw at 30 FPS while the timer runs
+
 void toggle_decorations(LSAppWindow* win)
 {
     gtk_window_set_decorated(GTK_WINDOW(win), !win->opts.decorated);
@@ -41,3 +43,55 @@ gboolean ls_app_window_resize(GtkWidget* widget,
     resize_window(win, event->configure.width, event->configure.height);
     return FALSE;
 }
+
+/**
+ * Draws all the components with the current state of the timer.
+ */
+static void draw_components(LSAppWindow* win)
+{
+    GList* l;
+    ls_timer_step(win->timer, ls_time_now());
+    for (l = win->components; l != NULL; l = l->next) {
+        LSComponent* component = l->data;
+        if (component->ops->draw) {
+            component->ops->draw(component, win->game, win->timer);
+        }
+    }
+}
+
+/**
+ * The render clock, redrawing the window until the timer stops.
+ *
+ * @param data Pointer to the LibreSplit window.
+ */
+static gboolean render_tick(gpointer data)
+{
+    LSAppWindow* win = data;
+    if (win->timer) {
+        draw_components(win);
+        if (win->timer->running) {
+            return G_SOURCE_CONTINUE;
+        }
+    }
+    win->draw_source = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Redraws the window after a change, and keeps redrawing it while the timer runs.
+ *
+ * Nothing polls the timer, so this has to be called every time its state changes.
+ *
+ * @param win The LibreSplit window.
+ */
+void ls_app_window_redraw(LSAppWindow* win)
+{
+    if (!win->timer) {
+        gtk_widget_queue_draw(GTK_WIDGET(win));
+        return;
+    }
+    draw_components(win);
+    if (win->timer->running && !win->draw_source) {
+        win->draw_source = g_timeout_add(RENDER_INTERVAL_MS, render_tick, win);
+    }
+}
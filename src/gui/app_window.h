@@ -37,11 +37,13 @@ typedef struct _LSAppWindow {
     GtkWidget* footer;
     GtkCssProvider* style; // Current style provider, there can be only one
     LSKeybinds keybinds; /*!< The keybinds related to this application window */
-    DelayedHandlers delayed_handlers; /*!< Handlers due for the next window step */
+    DelayedHandlers delayed_handlers; /*!< Handlers due for the next idle callback */
+    guint draw_source; /*!< The render clock, only running while the timer does */
     LSOpts opts; /*!< The window options */
 } LSAppWindow;
 
 void toggle_decorations(LSAppWindow* win);
 void toggle_win_on_top(LSAppWindow* win);
+void ls_app_window_redraw(LSAppWindow* win);
 
 gboolean ls_app_window_resize(GtkWidget* widget, GdkEvent* event, gpointer data);
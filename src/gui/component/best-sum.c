@@ -84,8 +84,8 @@ static void best_sum_show_game(LSComponent* self_,
 {
     LSBestSum* self = (LSBestSum*)self_;
     char str[256];
-    if (game->split_count && timer->sum_of_bests) {
-        ls_time_string(str, timer->sum_of_bests);
+    if (game->split_count && ls_timer_sum_of_bests(timer)) {
+        ls_time_string(str, ls_timer_sum_of_bests(timer));
         gtk_label_set_text(GTK_LABEL(self->sum_of_bests), str);
     }
 }
@@ -112,13 +112,13 @@ static void best_sum_draw(LSComponent* self_, const ls_game* game,
     const ls_timer* timer)
 {
     LSBestSum* self = (LSBestSum*)self_;
-    char str[256];
     remove_class(self->sum_of_bests, "time");
-    gtk_label_set_text(GTK_LABEL(self->sum_of_bests), "-");
-    if (timer->sum_of_bests) {
+    long long sum_of_bests = ls_timer_sum_of_bests(timer);
+    if (sum_of_bests) {
         add_class(self->sum_of_bests, "time");
-        ls_time_string(str, timer->sum_of_bests);
-        gtk_label_set_text(GTK_LABEL(self->sum_of_bests), str);
+        set_label_time(self->sum_of_bests, sum_of_bests, LS_TIME_FORMAT_TIME);
+    } else {
+        set_label_text(self->sum_of_bests, "-");
     }
 }
 
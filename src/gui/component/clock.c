@@ -141,8 +141,8 @@ static void timer_draw(LSComponent* self_, const ls_game* game, const ls_timer*
     }
     ls_time_millis_string(str, &millis[1], timer->time);
     millis[0] = '.';
-    gtk_label_set_text(GTK_LABEL(self->time_seconds), str);
-    gtk_label_set_text(GTK_LABEL(self->time_millis), millis);
+    set_label_text(self->time_seconds, str);
+    set_label_text(self->time_millis, millis);
 }
 
 LSComponentOps ls_timer_operations = {
@@ -206,25 +206,25 @@ static void detailed_timer_draw(LSComponent* self_, const ls_game* game, const l
     ls_time_millis_string(str, &millis[1], timer->time);
     if (millis[1] != '\0')
         millis[0] = '.';
-    gtk_label_set_text(GTK_LABEL(self->time_seconds), str);
-    gtk_label_set_text(GTK_LABEL(self->time_millis), millis);
+    set_label_text(self->time_seconds, str);
+    set_label_text(self->time_millis, millis);
 
     if (timer->curr_split == 0) {
-        gtk_label_set_text(GTK_LABEL(self->segment_seconds), str);
-        gtk_label_set_text(GTK_LABEL(self->segment_millis), millis);
+        set_label_text(self->segment_seconds, str);
+        set_label_text(self->segment_millis, millis);
     } else {
         ls_time_millis_string(seg, &seg_millis[1], timer->segment_times[timer->curr_split]);
         if (seg_millis[1] != '\0')
             seg_millis[0] = '.';
-        gtk_label_set_text(GTK_LABEL(self->segment_seconds), seg);
-        gtk_label_set_text(GTK_LABEL(self->segment_millis), seg_millis);
+        set_label_text(self->segment_seconds, seg);
+        set_label_text(self->segment_millis, seg_millis);
     }
 
     ls_time_string(&pb[6], game->segment_times[timer->curr_split]);
-    gtk_label_set_text(GTK_LABEL(self->segment_pb), pb);
+    set_label_text(self->segment_pb, pb);
 
     ls_time_string(&best[6], game->best_segments[timer->curr_split]);
-    gtk_label_set_text(GTK_LABEL(self->segment_best), best);
+    set_label_text(self->segment_best, best);
 }
 
 LSComponentOps ls_detailed_timer_operations = {
@@ -4,6 +4,8 @@
  */
 #include "components.h"
 
+#include <limits.h>
+
 /**
  * @brief The component representing a personal best
  */
@@ -113,24 +115,20 @@ static void pb_draw(LSComponent* self_, const ls_game* game,
     const ls_timer* timer)
 {
     LSPb* self = (LSPb*)self_;
-    char str[256];
+    long long personal_best = LLONG_MAX; // Shown as -
     remove_class(self->personal_best, "time");
-    gtk_label_set_text(GTK_LABEL(self->personal_best), "-");
     if (timer->curr_split == game->split_count
         && timer->split_times[game->split_count - 1]
         && (!game->split_times[game->split_count - 1]
             || (timer->split_times[game->split_count - 1]
                 < game->split_times[game->split_count - 1]))) {
         add_class(self->personal_best, "time");
-        ls_time_string(
-            str, timer->split_times[game->split_count - 1]);
-        gtk_label_set_text(GTK_LABEL(self->personal_best), str);
+        personal_best = timer->split_times[game->split_count - 1];
     } else if (game->split_times[game->split_count - 1]) {
         add_class(self->personal_best, "time");
-        ls_time_string(
-            str, game->split_times[game->split_count - 1]);
-        gtk_label_set_text(GTK_LABEL(self->personal_best), str);
+        personal_best = game->split_times[game->split_count - 1];
     }
+    set_label_time(self->personal_best, personal_best, LS_TIME_FORMAT_TIME);
 }
 
 LSComponentOps ls_pb_operations = {
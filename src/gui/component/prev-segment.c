@@ -4,6 +4,8 @@
  */
 #include "components.h"
 
+#include <limits.h>
+
 /**
  * @brief The component representing the "Previous segment" part of LibreSplit
  */
@@ -116,7 +118,6 @@ static void prev_segment_draw(LSComponent* self_, const ls_game* game,
 {
     LSPrevSegment* self = (LSPrevSegment*)self_;
     const char* label;
-    char str[256];
     int prev, curr = timer->curr_split;
     if (curr == game->split_count) {
         --curr;
@@ -126,7 +127,7 @@ static void prev_segment_draw(LSComponent* self_, const ls_game* game,
     remove_class(self->previous_segment, "behind");
     remove_class(self->previous_segment, "losing");
     remove_class(self->previous_segment, "delta");
-    gtk_label_set_text(GTK_LABEL(self->previous_segment), "-");
+    long long delta = LLONG_MAX; // Shown as -
 
     label = PREVIOUS_SEGMENT;
     if (timer->segment_deltas[curr] > 0) {
@@ -136,8 +137,7 @@ static void prev_segment_draw(LSComponent* self_, const ls_game* game,
         add_class(self->previous_segment, "behind");
         add_class(self->previous_segment, "losing");
         add_class(self->previous_segment, "delta");
-        ls_delta_string(str, timer->segment_deltas[curr]);
-        gtk_label_set_text(GTK_LABEL(self->previous_segment), str);
+        delta = timer->segment_deltas[curr];
     } else if (curr) {
         prev = timer->curr_split - 1;
         // Previous segment
@@ -152,12 +152,12 @@ static void prev_segment_draw(LSComponent* self_, const ls_game* game,
                     add_class(self->previous_segment, "losing");
                 }
                 add_class(self->previous_segment, "delta");
-                ls_delta_string(str, timer->segment_deltas[prev]);
-                gtk_label_set_text(GTK_LABEL(self->previous_segment), str);
+                delta = timer->segment_deltas[prev];
             }
         }
     }
-    gtk_label_set_text(GTK_LABEL(self->previous_segment_label), label);
+    set_label_time(self->previous_segment, delta, LS_TIME_FORMAT_DELTA);
+    set_label_text(self->previous_segment_label, label);
 }
 
 LSComponentOps ls_prev_segment_operations = {
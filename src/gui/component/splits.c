@@ -24,6 +24,13 @@ typedef struct LSSplits {
     GtkWidget** split_deltas;
     GtkWidget** split_times;
     GtkCssProvider* icons_css_provider;
+    const int* split_sections; /*!< Section of each split, from the game */
+    int section_count; /*!< The number of sections */
+    int open_section; /*!< The section whose splits are shown, -1 if none */
+    GtkWidget** section_rows; /*!< The header of each section */
+    GtkWidget** section_titles;
+    GtkWidget** section_deltas;
+    GtkWidget** section_times;
 } LSSplits;
 extern LSComponentOps ls_splits_operations;
 
@@ -62,6 +69,8 @@ LSComponent* ls_component_splits_new()
     gtk_widget_show(self->splits);
 
     self->icons_css_provider = NULL;
+    self->section_count = 0;
+    self->open_section = -1;
 
     self->split_last = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
     add_class(self->split_last, "split-last");
@@ -96,10 +105,94 @@ static GtkWidget* splits_widget(LSComponent* self)
     return ((LSSplits*)self)->container;
 }
 
+/**
+ * Checks whether the row of a split is shown, which it isn't when its section is closed.
+ */
+static bool split_visible(const LSSplits* self, int i)
+{
+    int section = self->section_count ? self->split_sections[i] : -1;
+    return section < 0 || section == self->open_section;
+}
+
+/**
+ * Gets the title showing a split: its own, or the one of its section when it's closed.
+ */
+static GtkWidget* split_row_title(const LSSplits* self, int i)
+{
+    return split_visible(self, i) ? self->split_titles[i] : self->section_titles[self->split_sections[i]];
+}
+
+/**
+ * Shows the splits of a section, hiding the ones of the other sections.
+ *
+ * @param self The splits component.
+ * @param section The section to open, -1 to close them all.
+ */
+static void splits_open_section(LSSplits* self, int section)
+{
+    int i;
+    self->open_section = section;
+    for (i = 0; i < self->split_count; ++i) {
+        if (self->split_sections[i] >= 0) {
+            gtk_widget_set_visible(self->split_rows[i], split_visible(self, i));
+        }
+    }
+    for (i = 0; i < self->section_count; ++i) {
+        if (i == section) {
+            add_class(self->section_rows[i], "open");
+        } else {
+            remove_class(self->section_rows[i], "open");
+        }
+    }
+}
+
+/**
+ * Adds the header of a section, before its splits.
+ *
+ * @param self The splits component.
+ * @param game The game.
+ * @param section The section.
+ */
+static void splits_add_section(LSSplits* self, const ls_game* game, int section)
+{
+    self->section_rows[section] = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+    add_class(self->section_rows[section], "split");
+    add_class(self->section_rows[section], "section");
+    gtk_widget_set_hexpand(self->section_rows[section], TRUE);
+    gtk_container_add(GTK_CONTAINER(self->splits),
+        self->section_rows[section]);
+
+    self->section_titles[section] = gtk_label_new(game->section_titles[section]);
+    add_class(self->section_titles[section], "split-title");
+    add_class(self->section_titles[section], "section-title");
+    gtk_widget_set_halign(self->section_titles[section], GTK_ALIGN_START);
+    gtk_widget_set_hexpand(self->section_titles[section], TRUE);
+    gtk_container_add(GTK_CONTAINER(self->section_rows[section]),
+        self->section_titles[section]);
+
+    self->section_deltas[section] = gtk_label_new(NULL);
+    add_class(self->section_deltas[section], "split-delta");
+    gtk_widget_set_size_request(self->section_deltas[section], 1, -1);
+    gtk_container_add(GTK_CONTAINER(self->section_rows[section]),
+        self->section_deltas[section]);
+
+    self->section_times[section] = gtk_label_new(NULL);
+    add_class(self->section_times[section], "split-time");
+    gtk_widget_set_halign(self->section_times[section], GTK_ALIGN_END);
+    gtk_container_add(GTK_CONTAINER(self->section_rows[section]),
+        self->section_times[section]);
+
+    gtk_widget_show_all(self->section_rows[section]);
+}
+
 static void splits_trailer(LSComponent* self_)
 {
     LSSplits* self = (LSSplits*)self_;
     int height, split_h, last = self->split_count - 1;
+    if (self->section_count && self->split_sections[last] >= 0) {
+        // The last split stays in its section
+        return;
+    }
     double curr_scroll = gtk_adjustment_get_value(self->split_adjust);
     double scroll_max = gtk_adjustment_get_upper(self->split_adjust);
     double page_size = gtk_adjustment_get_page_size(self->split_adjust);
@@ -178,11 +271,36 @@ static void splits_show_game(LSComponent* self_, const ls_game* game,
         return;
     }
 
+    self->split_sections = game->split_sections;
+    self->section_count = game->section_count;
+    self->open_section = -1;
+    self->section_rows = NULL;
+    self->section_titles = NULL;
+    self->section_deltas = NULL;
+    self->section_times = NULL;
+    if (self->section_count) {
+        self->section_rows = calloc(self->section_count, sizeof(GtkWidget*));
+        self->section_titles = calloc(self->section_count, sizeof(GtkWidget*));
+        self->section_deltas = calloc(self->section_count, sizeof(GtkWidget*));
+        self->section_times = calloc(self->section_count, sizeof(GtkWidget*));
+        if (!self->section_rows || !self->section_titles || !self->section_deltas || !self->section_times) {
+            // Show the splits without their sections
+            self->section_count = 0;
+        }
+    }
+
     GString* icons_css_src = g_string_new(".split-icon { background-repeat: no-repeat; background-position: center; min-width: 20px; min-height: 20px; background-size: 20px; margin-right: 4px; }");
 
     for (i = 0; i < self->split_count; ++i) {
+        int section = self->section_count ? game->split_sections[i] : -1;
+        if (section >= 0 && game->section_starts[section] == i) {
+            splits_add_section(self, game, section);
+        }
         self->split_rows[i] = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
         add_class(self->split_rows[i], "split");
+        if (section >= 0) {
+            add_class(self->split_rows[i], "subsplit");
+        }
         gtk_widget_set_hexpand(self->split_rows[i], TRUE);
         gtk_container_add(GTK_CONTAINER(self->splits),
             self->split_rows[i]);
@@ -238,8 +356,8 @@ static void splits_show_game(LSComponent* self_, const ls_game* game,
         gtk_container_add(GTK_CONTAINER(self->split_rows[i]),
             self->split_times[i]);
 
-        if (game->split_times[i]) {
-            ls_split_string(str, game->split_times[i], 0);
+        if (timer->comparison_splits[i]) {
+            ls_split_string(str, timer->comparison_splits[i], 0);
             gtk_label_set_text(GTK_LABEL(self->split_times[i]), str);
         }
 
@@ -270,6 +388,10 @@ static void splits_show_game(LSComponent* self_, const ls_game* game,
         g_string_free(icons_css_src, TRUE);
     }
 
+    if (self->section_count) {
+        splits_open_section(self, game->split_sections[0]);
+    }
+
     gtk_widget_show(self->splits);
     splits_trailer(self_);
 }
@@ -290,12 +412,22 @@ static void splits_clear_game(LSComponent* self_)
             GTK_CONTAINER(gtk_widget_get_parent(self->split_rows[i])),
             self->split_rows[i]);
     }
+    for (i = self->section_count - 1; i >= 0; --i) {
+        gtk_container_remove(GTK_CONTAINER(self->splits),
+            self->section_rows[i]);
+    }
     gtk_adjustment_set_value(self->split_adjust, 0);
     free(self->split_rows);
     free(self->split_titles);
     free(self->split_deltas);
     free(self->split_times);
+    free(self->section_rows);
+    free(self->section_titles);
+    free(self->section_deltas);
+    free(self->section_times);
     self->split_count = 0;
+    self->section_count = 0;
+    self->open_section = -1;
 }
 
 #define SHOW_DELTA_THRESHOLD (-30 * 1000000LL)
@@ -309,9 +441,18 @@ static void splits_clear_game(LSComponent* self_)
 static void splits_draw(LSComponent* self_, const ls_game* game, const ls_timer* timer)
 {
     LSSplits* self = (LSSplits*)self_;
-    char str[256];
     int i;
+    if (self->section_count) {
+        // Open the section of the current split
+        int curr = timer->curr_split < self->split_count ? timer->curr_split : self->split_count - 1;
+        if (self->split_sections[curr] != self->open_section) {
+            splits_open_section(self, self->split_sections[curr]);
+        }
+    }
     for (i = 0; i < self->split_count; ++i) {
+        if (!split_visible(self, i)) {
+            continue;
+        }
         if (i == timer->curr_split
             && timer->start_time) {
             add_class(self->split_rows[i], "current-split");
@@ -322,28 +463,26 @@ static void splits_draw(LSComponent* self_, const ls_game* game, const ls_timer*
         remove_class(self->split_times[i], "time");
         remove_class(self->split_times[i], "done");
 
-        // Set split_times label to -
-        gtk_label_set_text(GTK_LABEL(self->split_times[i]), "-");
-
+        // Show - when there's no time
+        long long split_time = LLONG_MAX;
         if (i < timer->curr_split) {
             add_class(self->split_times[i], "done");
             if (timer->split_times[i]) {
                 add_class(self->split_times[i], "time");
-                ls_split_string(str, timer->split_times[i], 0);
-                gtk_label_set_text(GTK_LABEL(self->split_times[i]), str);
+                split_time = timer->split_times[i];
             }
-        } else if (game->split_times[i]) {
+        } else if (timer->comparison_splits[i]) {
             add_class(self->split_times[i], "time");
-            ls_split_string(str, game->split_times[i], 0);
-            gtk_label_set_text(GTK_LABEL(self->split_times[i]), str);
+            split_time = timer->comparison_splits[i];
         }
+        set_label_time(self->split_times[i], split_time, LS_TIME_FORMAT_TIME);
 
         remove_class(self->split_deltas[i], "best-split");
         remove_class(self->split_deltas[i], "best-segment");
         remove_class(self->split_deltas[i], "behind");
         remove_class(self->split_deltas[i], "losing");
         remove_class(self->split_deltas[i], "delta");
-        gtk_label_set_text(GTK_LABEL(self->split_deltas[i]), "");
+        bool show_delta = false;
         if (i < timer->curr_split
             || timer->split_deltas[i] >= SHOW_DELTA_THRESHOLD) {
             if (timer->split_info[i] & LS_INFO_BEST_SPLIT) {
@@ -367,35 +506,75 @@ static void splits_draw(LSComponent* self_, const ls_game* game, const ls_timer*
             }
             if (timer->split_deltas[i]) {
                 add_class(self->split_deltas[i], "delta");
-                ls_delta_string(str, timer->split_deltas[i]);
-                gtk_label_set_text(GTK_LABEL(self->split_deltas[i]), str);
+                set_label_time(self->split_deltas[i], timer->split_deltas[i], LS_TIME_FORMAT_DELTA);
+                show_delta = true;
             }
         }
+        if (!show_delta) {
+            set_label_text(self->split_deltas[i], "");
+        }
+    }
+
+    // Headers show the time at the end of the section and the time gained or lost in it
+    for (i = 0; i < self->section_count; ++i) {
+        int start = game->section_starts[i];
+        int end = game->section_ends[i];
+        long long section_time = LLONG_MAX;
+        remove_class(self->section_times[i], "done");
+        if (end < timer->curr_split) {
+            add_class(self->section_times[i], "done");
+            if (timer->split_times[end]) {
+                section_time = timer->split_times[end];
+            }
+        } else if (timer->comparison_splits[end]) {
+            section_time = timer->comparison_splits[end];
+        }
+        set_label_time(self->section_times[i], section_time, LS_TIME_FORMAT_TIME);
+
+        remove_class(self->section_deltas[i], "delta");
+        remove_class(self->section_deltas[i], "behind");
+        if (start < timer->curr_split && timer->section_deltas[i]) {
+            add_class(self->section_deltas[i], "delta");
+            if (timer->section_deltas[i] > 0) {
+                add_class(self->section_deltas[i], "behind");
+            }
+            set_label_time(self->section_deltas[i], timer->section_deltas[i], LS_TIME_FORMAT_DELTA);
+        } else {
+            set_label_text(self->section_deltas[i], "");
+        }
     }
 
     // keep split sizes in sync
     if (self->split_count) {
         int width;
         int time_width = 0, delta_width = 0;
-        for (i = 0; i < self->split_count; ++i) {
-            width = gtk_widget_get_allocated_width(self->split_deltas[i]);
+        for (i = 0; i < self->split_count + self->section_count; ++i) {
+            GtkWidget* delta = i < self->split_count ? self->split_deltas[i] : self->section_deltas[i - self->split_count];
+            GtkWidget* time = i < self->split_count ? self->split_times[i] : self->section_times[i - self->split_count];
+            if (i < self->split_count && !split_visible(self, i)) {
+                continue;
+            }
+            width = gtk_widget_get_allocated_width(delta);
             if (width > delta_width) {
                 delta_width = width;
             }
-            width = gtk_widget_get_allocated_width(self->split_times[i]);
+            width = gtk_widget_get_allocated_width(time);
             if (width > time_width) {
                 time_width = width;
             }
         }
-        for (i = 0; i < self->split_count; ++i) {
+        for (i = 0; i < self->split_count + self->section_count; ++i) {
+            GtkWidget* delta = i < self->split_count ? self->split_deltas[i] : self->section_deltas[i - self->split_count];
+            GtkWidget* time = i < self->split_count ? self->split_times[i] : self->section_times[i - self->split_count];
+            if (i < self->split_count && !split_visible(self, i)) {
+                continue;
+            }
             if (delta_width) {
-                gtk_widget_set_size_request(
-                    self->split_deltas[i], delta_width, -1);
+                gtk_widget_set_size_request(delta, delta_width, -1);
             }
             if (time_width) {
-                width = gtk_widget_get_allocated_width(
-                    self->split_times[i]);
-                gtk_widget_set_margin_start(self->split_times[i],
+                width = gtk_widget_get_allocated_width(time);
+                gtk_widget_set_margin_start(time,
                     /*WINDOW_PAD*/ 8 * 2 + (time_width - width));
             }
         }
@@ -426,16 +605,16 @@ static void splits_scroll_to_split(LSComponent* self_, const ls_timer* timer)
     }
     curr_scroll = gtk_adjustment_get_value(self->split_adjust);
     gtk_widget_translate_coordinates(
-        self->split_titles[prev],
+        split_row_title(self, prev),
         self->split_viewport,
         0, 0, &split_x, &split_y);
     scroller_h = gtk_widget_get_allocated_height(self->split_scroller);
-    split_h = gtk_widget_get_allocated_height(self->split_titles[prev]);
+    split_h = gtk_widget_get_allocated_height(split_row_title(self, prev));
     if (curr != next && curr != prev) {
-        split_h += gtk_widget_get_allocated_height(self->split_titles[curr]);
+        split_h += gtk_widget_get_allocated_height(split_row_title(self, curr));
     }
     if (next != prev) {
-        int h = gtk_widget_get_allocated_height(self->split_titles[next]);
+        int h = gtk_widget_get_allocated_height(split_row_title(self, next));
         if (split_h + h < scroller_h) {
             split_h += h;
         }
@@ -114,17 +114,15 @@ static void wr_draw(LSComponent* self_, const ls_game* game,
     const ls_timer* timer)
 {
     LSWr* self = (LSWr*)self_;
-    char str[256];
     if (timer->curr_split == game->split_count
         && game->world_record) {
         if (timer->split_times[game->split_count - 1]
             && timer->split_times[game->split_count - 1]
                 < game->world_record) {
-            ls_time_string(str, timer->split_times[game->split_count - 1]);
+            set_label_time(self->world_record, timer->split_times[game->split_count - 1], LS_TIME_FORMAT_TIME);
         } else {
-            ls_time_string(str, game->world_record);
+            set_label_time(self->world_record, game->world_record, LS_TIME_FORMAT_TIME);
         }
-        gtk_label_set_text(GTK_LABEL(self->world_record), str);
     }
 }
 
@@ -3,6 +3,14 @@
 #include "src/gui/theming.h"
 #include "src/lasr/auto-splitter.h"
 #include "src/settings/definitions.h"
+#include "src/settings/utils.h"
+
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAVE_COALESCE_US 50000 // Time to wait for another save before writing one
 
 extern AppConfig cfg;
 
@@ -63,15 +71,111 @@ void ls_app_window_show_game(LSAppWindow* win)
     gtk_widget_hide(win->welcome_box->box);
 }
 
-gpointer save_game_thread(gpointer data)
+/**
+ * A snapshot of a split file, waiting to be written by the save thread.
+ */
+typedef struct GameSave {
+    char* path; /*!< Where to write it, NULL to stop the thread */
+    json_t* json; /*!< The content of the split file */
+} GameSave;
+
+static GAsyncQueue* save_queue;
+static GThread* save_thread;
+
+static void game_save_free(GameSave* save)
 {
-    ls_game* game = data;
-    ls_game_save(game);
+    free(save->path);
+    if (save->json) {
+        json_decref(save->json);
+    }
+    free(save);
+}
+
+/**
+ * Writes the snapshots of the split files queued by save_game.
+ *
+ * A snapshot is only written once no other one of the same file was queued for
+ * SAVE_COALESCE_US, so a burst of saves is written once, with its last snapshot.
+ *
+ * @param data The queue of snapshots.
+ */
+static gpointer save_game_thread(gpointer data)
+{
+    GAsyncQueue* queue = data;
+    GameSave* pending = NULL;
+    for (;;) {
+        GameSave* save = pending ? g_async_queue_timeout_pop(queue, SAVE_COALESCE_US) : g_async_queue_pop(queue);
+        if (pending && (!save || !save->path || strcmp(save->path, pending->path) != 0)) {
+            if (save_json_file(pending->json, pending->path, JSON_PRESERVE_ORDER | JSON_INDENT(2))) {
+                printf("[save_game] Can't save %s\n", pending->path);
+            }
+            game_save_free(pending);
+            pending = NULL;
+        }
+        if (!save) {
+            continue;
+        }
+        if (!save->path) {
+            game_save_free(save);
+            break;
+        }
+        if (pending) {
+            game_save_free(pending);
+        }
+        pending = save;
+    }
     return NULL;
 }
 
-void save_game(ls_game* game)
+/**
+ * Starts the thread saving the split files.
+ */
+void save_game_init(void)
+{
+    save_queue = g_async_queue_new();
+    save_thread = g_thread_new("save_game", save_game_thread, save_queue);
+}
+
+/**
+ * Writes the split files still queued and stops the thread saving them.
+ */
+void save_game_shutdown(void)
 {
-    GThread* thread = g_thread_new("save_game", save_game_thread, game);
-    g_thread_unref(thread);
+    if (!save_thread) {
+        return;
+    }
+    GameSave* stop = calloc(1, sizeof(GameSave));
+    if (stop) {
+        g_async_queue_push(save_queue, stop);
+        g_thread_join(save_thread);
+    } else {
+        g_thread_unref(save_thread);
+    }
+    save_thread = NULL;
+}
+
+/**
+ * Queues the game to be saved to its split file.
+ *
+ * The game is copied as it is now, so it can be changed or released right after.
+ *
+ * @param game The game to save.
+ */
+void save_game(const ls_game* game)
+{
+    if (!save_thread) {
+        ls_game_save(game);
+        return;
+    }
+    GameSave* save = malloc(sizeof(GameSave));
+    if (!save) {
+        return;
+    }
+    save->path = strdup(game->path);
+    save->json = ls_game_to_json(game);
+    if (!save->path) {
+        game_save_free(save);
+        return;
+    }
+    g_async_queue_push(save_queue, save);
 }
@@ -4,5 +4,7 @@
 
 void ls_app_window_clear_game(LSAppWindow* win);
 void ls_app_window_show_game(LSAppWindow* win);
-void save_game(ls_game* game);
+void save_game_init(void);
+void save_game_shutdown(void);
+void save_game(const ls_game* game);
 void timer_start(LSAppWindow* win, bool updateComponents);
@@ -1,6 +1,7 @@
 #include "settings_dialog.h"
 #include "src/settings/definitions.h"
 #include "src/settings/settings.h"
+#include "src/timer.h"
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdk.h>
@@ -123,6 +124,7 @@ static void save_gui_settings(GSimpleAction* action, GVariant* parameter, gpoint
                 break;
         }
     }
+    ls_time_set_decimals(cfg.libresplit.decimals.value.i);
     // Call the normal save_settings thing
     config_save();
 }
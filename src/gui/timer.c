@@ -8,6 +8,7 @@ void timer_reset(LSAppWindow* win)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         if (win->timer->running) {
             ls_timer_stop(win->timer);
             for (l = win->components; l != NULL; l = l->next) {
@@ -28,6 +29,7 @@ void timer_reset(LSAppWindow* win)
                 component->ops->stop_reset(component, win->timer);
             }
         }
+        ls_app_window_redraw(win);
     }
 }
 
@@ -35,6 +37,7 @@ void timer_start_split(LSAppWindow* win)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         if (!win->timer->running) {
             if (ls_timer_start(win->timer)) {
                 save_game(win->game);
@@ -48,6 +51,7 @@ void timer_start_split(LSAppWindow* win)
                 component->ops->start_split(component, win->timer);
             }
         }
+        ls_app_window_redraw(win);
     }
 }
 
@@ -55,6 +59,7 @@ void timer_start(LSAppWindow* win, bool updateComponents)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         if (!win->timer->running) {
             if (ls_timer_start(win->timer)) {
                 save_game(win->game);
@@ -68,6 +73,7 @@ void timer_start(LSAppWindow* win, bool updateComponents)
                 }
             }
         }
+        ls_app_window_redraw(win);
     }
 }
 
@@ -75,6 +81,7 @@ void timer_stop_reset(LSAppWindow* win)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         if (is_run_started(win->timer)) {
             ls_timer_stop(win->timer);
         } else {
@@ -98,6 +105,7 @@ void timer_stop_reset(LSAppWindow* win)
                 component->ops->stop_reset(component, win->timer);
             }
         }
+        ls_app_window_redraw(win);
     }
 }
 
@@ -105,6 +113,7 @@ void timer_cancel_run(LSAppWindow* win)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         if (ls_timer_cancel(win->timer)) {
             ls_app_window_clear_game(win);
             ls_app_window_show_game(win);
@@ -116,6 +125,7 @@ void timer_cancel_run(LSAppWindow* win)
                 component->ops->cancel_run(component, win->timer);
             }
         }
+        ls_app_window_redraw(win);
     }
 }
 
@@ -123,6 +133,7 @@ void timer_skip(LSAppWindow* win)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         ls_timer_skip(win->timer);
         for (l = win->components; l != NULL; l = l->next) {
             LSComponent* component = l->data;
@@ -130,6 +141,7 @@ void timer_skip(LSAppWindow* win)
                 component->ops->skip(component, win->timer);
             }
         }
+        ls_app_window_redraw(win);
     }
 }
 
@@ -137,6 +149,7 @@ void timer_unsplit(LSAppWindow* win)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         ls_timer_unsplit(win->timer);
         for (l = win->components; l != NULL; l = l->next) {
             LSComponent* component = l->data;
@@ -144,6 +157,7 @@ void timer_unsplit(LSAppWindow* win)
                 component->ops->unsplit(component, win->timer);
             }
         }
+        ls_app_window_redraw(win);
     }
 }
 
@@ -151,6 +165,7 @@ void timer_split(LSAppWindow* win, bool updateComponents)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         ls_timer_split(win->timer);
         if (updateComponents) {
             for (l = win->components; l != NULL; l = l->next) {
@@ -160,6 +175,7 @@ void timer_split(LSAppWindow* win, bool updateComponents)
                 }
             }
         }
+        ls_app_window_redraw(win);
     }
 }
 
@@ -167,6 +183,7 @@ void timer_stop(LSAppWindow* win)
 {
     if (win->timer) {
         GList* l;
+        ls_timer_step(win->timer, ls_time_now());
         if (win->timer->running) {
             ls_timer_stop(win->timer);
         }
@@ -176,5 +193,6 @@ void timer_stop(LSAppWindow* win)
                 component->ops->stop_reset(component, win->timer);
             }
         }
+        ls_app_window_redraw(win);
     }
 }
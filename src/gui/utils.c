@@ -1,4 +1,11 @@
+#include "utils.h"
+#include "src/timer.h"
+
 #include <gtk/gtk.h>
+#include <limits.h>
+#include <string.h>
+
+#define LABEL_TIME_MAX 32 // Longest time shown by set_label_time
 
 /**
  * Adds a styling class to a GTK Widget.
@@ -21,3 +28,87 @@ void remove_class(GtkWidget* widget, const char* class)
 {
     gtk_style_context_remove_class(gtk_widget_get_style_context(widget), class);
 }
+
+/**
+ * Sets the text of a label, unless it already shows it.
+ *
+ * Setting the text makes GTK measure the label again, even if it's the same.
+ *
+ * @param label The label
+ * @param text The text to show
+ */
+void set_label_text(GtkWidget* label, const char* text)
+{
+    if (strcmp(gtk_label_get_text(GTK_LABEL(label)), text) != 0) {
+        gtk_label_set_text(GTK_LABEL(label), text);
+    }
+}
+
+/**
+ * The time shown by a label, as set by set_label_time.
+ */
+typedef struct LabelTime {
+    long long time; /*!< The time, truncated to the digits shown */
+    int format; /*!< How it was formatted */
+    int decimals; /*!< The decimals shown when it was formatted */
+    char text[LABEL_TIME_MAX]; /*!< What it was formatted to */
+} LabelTime;
+
+G_DEFINE_QUARK(ls-label-time, label_time)
+
+/**
+ * Truncates a time to the digits shown, keeping the sign so that times shown as "-0"
+ * and "0" are told apart.
+ */
+static long long visible_time(long long time, int decimals)
+{
+    if (time == LLONG_MAX) {
+        return time;
+    }
+    long long unit = 1;
+    for (int i = decimals; i < 6; ++i) {
+        unit *= 10;
+    }
+    return time >= 0 ? time / unit : -(-time / unit) - 1;
+}
+
+/**
+ * Shows a time in a label.
+ *
+ * The label remembers the time it shows, so the time is only formatted again when its
+ * visible digits change, and the label is only updated when its text does.
+ *
+ * @param label The label
+ * @param time The time, LLONG_MAX for none
+ * @param format How to format it
+ */
+void set_label_time(GtkWidget* label, long long time, LSTimeFormat format)
+{
+    LabelTime* shown = g_object_get_qdata(G_OBJECT(label), label_time_quark());
+    if (!shown) {
+        shown = g_new0(LabelTime, 1);
+        shown->format = -1;
+        g_object_set_qdata_full(G_OBJECT(label), label_time_quark(), shown, g_free);
+    }
+    int decimals = ls_time_decimals();
+    long long visible = visible_time(time, decimals);
+    const char* current = gtk_label_get_text(GTK_LABEL(label));
+    if (visible == shown->time && (int)format == shown->format && decimals == shown->decimals
+        && strcmp(current, shown->text) == 0) {
+        return;
+    }
+
+    char text[256];
+    if (format == LS_TIME_FORMAT_DELTA) {
+        ls_delta_string(text, time);
+    } else {
+        ls_time_string(text, time);
+    }
+    shown->time = visible;
+    shown->format = format;
+    shown->decimals = decimals;
+    g_strlcpy(shown->text, text, sizeof(shown->text));
+    if (strcmp(current, text) != 0) {
+        gtk_label_set_text(GTK_LABEL(label), text);
+    }
+}
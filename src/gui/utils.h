@@ -2,6 +2,18 @@
 
 #include <gtk/gtk.h>
 
+/**
+ * How set_label_time formats a time.
+ */
+typedef enum LSTimeFormat {
+    LS_TIME_FORMAT_TIME, /*!< As ls_time_string does */
+    LS_TIME_FORMAT_DELTA, /*!< As ls_delta_string does */
+} LSTimeFormat;
+
 void add_class(GtkWidget* widget, const char* class);
 
 void remove_class(GtkWidget* widget, const char* class);
+
+void set_label_text(GtkWidget* label, const char* text);
+
+void set_label_time(GtkWidget* label, long long time, LSTimeFormat format);
@@ -0,0 +1,480 @@
+/** \file history.c
+ *
+ * Log of the attempts made with a split file
+ *
+ * Every attempt is appended as one line of JSON to a log kept in the runs folder, named
+ * after the split file and a hash of its full path. An index next to it has a fixed size record per attempt with its
+ * position in the log, so any attempt can be found without reading the ones before it.
+ */
+#include "history.h"
+#include "settings/utils.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_EXTENSION ".jsonl"
+#define INDEX_EXTENSION ".idx"
+
+static_assert(sizeof(ls_attempt) == 32, "The index records are written as they are");
+
+/**
+ * Builds the path of a file kept in the runs folder for a split file.
+ *
+ * @param split_path The path of the split file.
+ * @param keyed True to add the hash of the full path of the split file to the name,
+ * false for the name used by older versions.
+ * @param extension Appended to the name of the split file, without its own extension.
+ * @param[out] path The path, PATH_MAX long.
+ *
+ * @return False if the path is too long.
+ */
+static bool runs_file_path(const char* split_path, bool keyed, const char* extension, char* path)
+{
+    char runs_path[PATH_MAX];
+    get_libresplit_folder_path(runs_path);
+    strncat(runs_path, "/runs", sizeof(runs_path) - strlen(runs_path) - 1);
+
+    const char* name = strrchr(split_path, '/');
+    name = name ? name + 1 : split_path;
+    int length = (int)strlen(name);
+    const char* split_extension = strrchr(name, '.');
+    if (split_extension && strcmp(split_extension, ".json") == 0) {
+        length = (int)(split_extension - name);
+    }
+    if (!keyed) {
+        return snprintf(path, PATH_MAX, "%s/%.*s%s", runs_path, length, name, extension) < PATH_MAX;
+    }
+
+    // Split files with the same name in different folders get their own files
+    char absolute_path[PATH_MAX];
+    if (!realpath(split_path, absolute_path)) {
+        snprintf(absolute_path, sizeof(absolute_path), "%s", split_path);
+    }
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (const char* c = absolute_path; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    return snprintf(path, PATH_MAX, "%s/%.*s-%08x%s", runs_path, length, name, hash, extension) < PATH_MAX;
+}
+
+/**
+ * Gets the path of a file kept in the runs folder for a split file.
+ *
+ * The name is the one of the split file followed by a hash of its full path, so moving
+ * the split file starts a new history.
+ *
+ * @param split_path The path of the split file.
+ * @param extension Appended to the name of the split file, without its own extension.
+ * @param[out] path The path, PATH_MAX long.
+ *
+ * @return False if the path is too long.
+ */
+bool ls_history_file_path(const char* split_path, const char* extension, char* path)
+{
+    return runs_file_path(split_path, true, extension, path);
+}
+
+/**
+ * Gets the paths of the log and index of a split file.
+ *
+ * @return False if the paths are too long.
+ */
+static bool history_paths(const char* split_path, char* log_path, char* index_path)
+{
+    return ls_history_file_path(split_path, LOG_EXTENSION, log_path)
+        && ls_history_file_path(split_path, INDEX_EXTENSION, index_path);
+}
+
+static bool write_all(int fd, const char* buffer, size_t size)
+{
+    while (size) {
+        ssize_t written = write(fd, buffer, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buffer += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * Checks whether a saved run was made with the same splits as the game.
+ *
+ * @param game The game.
+ * @param run The saved run.
+ */
+bool ls_history_run_matches(const ls_game* game, json_t* run)
+{
+    json_t* title = json_object_get(run, "title");
+    if (game->title ? !json_is_string(title) || strcmp(game->title, json_string_value(title)) != 0
+                    : title != NULL) {
+        return false;
+    }
+    json_t* splits = json_object_get(run, "splits");
+    if (!json_is_array(splits) || (int)json_array_size(splits) != game->split_count) {
+        return false;
+    }
+    for (int i = 0; i < game->split_count; ++i) {
+        json_t* split_title = json_object_get(json_array_get(splits, i), "title");
+        if (game->split_titles[i] && (!json_is_string(split_title) || strcmp(game->split_titles[i], json_string_value(split_title)) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Appends an attempt to the log of a split file.
+ *
+ * @param split_path The path of the split file.
+ * @param run The attempt, as saved in the log.
+ * @param[in,out] attempt The index record, its id and offset are filled in.
+ *
+ * @return Non-zero on error.
+ */
+int ls_history_append(const char* split_path, json_t* run, ls_attempt* attempt)
+{
+    char log_path[PATH_MAX];
+    char index_path[PATH_MAX];
+    if (!history_paths(split_path, log_path, index_path)) {
+        printf("[history] The path of the attempt log is too long\n");
+        return 1;
+    }
+
+    char* line = json_dumps(run, JSON_PRESERVE_ORDER | JSON_COMPACT);
+    if (!line) {
+        return 1;
+    }
+    int error = 1;
+    int log_fd = open(log_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    int index_fd = open(index_path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    struct stat log_stat, index_stat;
+    if (log_fd < 0 || index_fd < 0 || fstat(log_fd, &log_stat) || fstat(index_fd, &index_stat)) {
+        printf("[history] Can't open %s: %s\n", log_fd < 0 ? log_path : index_path, strerror(errno));
+        goto append_done;
+    }
+
+    // A record cut short by a crash is overwritten
+    off_t records = index_stat.st_size / (off_t)sizeof(ls_attempt);
+    attempt->id = (uint32_t)records + 1;
+    attempt->offset = (uint64_t)log_stat.st_size;
+    attempt->reserved = 0;
+
+    size_t length = strlen(line);
+    line[length] = '\n'; // Replaces the terminator, the length is known
+    if (!write_all(log_fd, line, length + 1)) {
+        printf("[history] Can't write to %s: %s\n", log_path, strerror(errno));
+        goto append_done;
+    }
+    if (pwrite(index_fd, attempt, sizeof(ls_attempt), records * (off_t)sizeof(ls_attempt)) != sizeof(ls_attempt)) {
+        printf("[history] Can't write to %s: %s\n", index_path, strerror(errno));
+        goto append_done;
+    }
+    error = 0;
+
+append_done:
+    if (log_fd >= 0) {
+        close(log_fd);
+    }
+    if (index_fd >= 0) {
+        close(index_fd);
+    }
+    free(line);
+    return error;
+}
+
+/**
+ * Gets the number of attempts in the log of a split file.
+ *
+ * @param split_path The path of the split file.
+ */
+uint32_t ls_history_count(const char* split_path)
+{
+    char log_path[PATH_MAX];
+    char index_path[PATH_MAX];
+    struct stat index_stat;
+    if (!history_paths(split_path, log_path, index_path) || stat(index_path, &index_stat)) {
+        return 0;
+    }
+    return (uint32_t)(index_stat.st_size / (off_t)sizeof(ls_attempt));
+}
+
+/**
+ * Reads the index record of an attempt.
+ *
+ * @param split_path The path of the split file.
+ * @param id The id of the attempt, starting at 1.
+ * @param[out] attempt The index record.
+ *
+ * @return False if there's no such attempt.
+ */
+bool ls_history_get(const char* split_path, uint32_t id, ls_attempt* attempt)
+{
+    char log_path[PATH_MAX];
+    char index_path[PATH_MAX];
+    if (!id || !history_paths(split_path, log_path, index_path)) {
+        return false;
+    }
+    int index_fd = open(index_path, O_RDONLY | O_CLOEXEC);
+    if (index_fd < 0) {
+        return false;
+    }
+    ssize_t n_read = pread(index_fd, attempt, sizeof(ls_attempt), (off_t)(id - 1) * (off_t)sizeof(ls_attempt));
+    close(index_fd);
+    return n_read == sizeof(ls_attempt) && attempt->id == id;
+}
+
+/**
+ * Reads the line of an attempt from an open log.
+ */
+static json_t* load_line(FILE* log, uint64_t offset)
+{
+    char* line = NULL;
+    size_t capacity = 0;
+    json_t* run = NULL;
+    if (fseeko(log, (off_t)offset, SEEK_SET) == 0 && getline(&line, &capacity, log) > 0) {
+        run = json_loads(line, 0, NULL);
+    }
+    free(line);
+    return run;
+}
+
+/**
+ * Reads an attempt from the log.
+ *
+ * @param split_path The path of the split file.
+ * @param attempt The index record of the attempt.
+ *
+ * @return The attempt, to be released with json_decref, or NULL if it can't be read.
+ */
+json_t* ls_history_load(const char* split_path, const ls_attempt* attempt)
+{
+    char log_path[PATH_MAX];
+    char index_path[PATH_MAX];
+    if (!history_paths(split_path, log_path, index_path)) {
+        return NULL;
+    }
+    FILE* log = fopen(log_path, "re");
+    if (!log) {
+        return NULL;
+    }
+    json_t* run = load_line(log, attempt->offset);
+    fclose(log);
+    return run;
+}
+
+/**
+ * Reads the attempts of the log as they were written, starting from one of them.
+ *
+ * The lines are given without parsing them, for readers that only need part of them.
+ * Attempts that can't be read are skipped.
+ *
+ * @param split_path The path of the split file.
+ * @param first_id The id of the first attempt to read, starting at 1.
+ * @param callback Called with each attempt and its line, which is freed after it returns.
+ * @param data Passed to the callback.
+ *
+ * @return Non-zero if the log can't be opened.
+ */
+int ls_history_foreach_line(const char* split_path, uint32_t first_id, ls_history_line_callback callback, void* data)
+{
+    char log_path[PATH_MAX];
+    char index_path[PATH_MAX];
+    if (!history_paths(split_path, log_path, index_path)) {
+        return 1;
+    }
+    FILE* index = fopen(index_path, "re");
+    FILE* log = fopen(log_path, "re");
+    if (!index || !log) {
+        if (index) {
+            fclose(index);
+        }
+        if (log) {
+            fclose(log);
+        }
+        return 1;
+    }
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ls_attempt attempt;
+    off_t start = first_id ? (off_t)(first_id - 1) * (off_t)sizeof(ls_attempt) : 0;
+    if (fseeko(index, start, SEEK_SET) == 0) {
+        while (fread(&attempt, sizeof(attempt), 1, index) == 1) {
+            if (fseeko(log, (off_t)attempt.offset, SEEK_SET) == 0 && getline(&line, &capacity, log) > 0) {
+                callback(&attempt, line, data);
+            }
+        }
+    }
+    free(line);
+    fclose(index);
+    fclose(log);
+    return 0;
+}
+
+/**
+ * Parses the lines given by ls_history_foreach_line for ls_history_foreach.
+ */
+typedef struct HistoryParser {
+    ls_history_callback callback;
+    void* data;
+} HistoryParser;
+
+static void parse_line(const ls_attempt* attempt, const char* line, void* data)
+{
+    HistoryParser* parser = data;
+    json_t* run = json_loads(line, 0, NULL);
+    if (run) {
+        parser->callback(attempt, run, parser->data);
+        json_decref(run);
+    }
+}
+
+/**
+ * Reads all the attempts of the log, in the order they were made.
+ *
+ * Attempts that can't be read are skipped.
+ *
+ * @param split_path The path of the split file.
+ * @param callback Called with each attempt, which is released after it returns.
+ * @param data Passed to the callback.
+ *
+ * @return Non-zero if the log can't be opened.
+ */
+int ls_history_foreach(const char* split_path, ls_history_callback callback, void* data)
+{
+    HistoryParser parser = { callback, data };
+    return ls_history_foreach_line(split_path, 1, parse_line, &parser);
+}
+
+static int compare_names(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * Imports the runs saved as separate JSON files in the runs folder by older versions,
+ * if the game doesn't have an attempt log yet.
+ *
+ * The runs made with the same title and splits are appended to the log in the order
+ * they were saved, which is the order of their names. The files are left in place.
+ *
+ * @param game The game.
+ *
+ * @return The number of imported runs, or -1 on error.
+ */
+int ls_history_import(const ls_game* game)
+{
+    char log_path[PATH_MAX];
+    char index_path[PATH_MAX];
+    if (!history_paths(game->path, log_path, index_path)) {
+        return -1;
+    }
+    if (access(log_path, F_OK) == 0) {
+        return 0;
+    }
+
+    // Logs used to be named after the split file only, the first split file opened with
+    // that name takes it over
+    char legacy_log_path[PATH_MAX];
+    char legacy_index_path[PATH_MAX];
+    if (runs_file_path(game->path, false, LOG_EXTENSION, legacy_log_path)
+        && runs_file_path(game->path, false, INDEX_EXTENSION, legacy_index_path)
+        && access(legacy_log_path, F_OK) == 0) {
+        if (rename(legacy_log_path, log_path) != 0) {
+            printf("[ls_history_import] Can't move %s: %s\n", legacy_log_path, strerror(errno));
+            return -1;
+        }
+        rename(legacy_index_path, index_path);
+        return 0;
+    }
+
+    char runs_path[PATH_MAX];
+    get_libresplit_folder_path(runs_path);
+    strncat(runs_path, "/runs", sizeof(runs_path) - strlen(runs_path) - 1);
+    DIR* dir = opendir(runs_path);
+    if (!dir) {
+        return -1;
+    }
+    char** names = NULL;
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir))) {
+        // Old runs are named run_<date>.json
+        const char* extension = strrchr(entry->d_name, '.');
+        if (strncmp(entry->d_name, "run_", 4) != 0 || !extension || strcmp(extension, ".json") != 0) {
+            continue;
+        }
+        char** grown = realloc(names, (count + 1) * sizeof(char*));
+        if (!grown) {
+            break;
+        }
+        names = grown;
+        names[count] = strdup(entry->d_name);
+        if (names[count]) {
+            count++;
+        }
+    }
+    closedir(dir);
+    if (count) {
+        qsort(names, count, sizeof(char*), compare_names);
+    }
+
+    int imported = 0;
+    for (int i = 0; i < count; i++) {
+        char run_path[PATH_MAX];
+        if (snprintf(run_path, sizeof(run_path), "%s/%s", runs_path, names[i]) < (int)sizeof(run_path)) {
+            json_t* run = json_load_file(run_path, 0, NULL);
+            if (run && ls_history_run_matches(game, run)) {
+                ls_attempt attempt = { 0 };
+                json_t* splits = json_object_get(run, "splits");
+                for (size_t j = 0; j < json_array_size(splits); j++) {
+                    if (json_object_get(json_array_get(splits, j), "time")) {
+                        attempt.reached_split = (uint32_t)j + 1;
+                    }
+                }
+                json_t* final_time = json_object_get(run, "final_time");
+                if (json_is_string(final_time)) {
+                    attempt.final_time = ls_time_value(json_string_value(final_time));
+                }
+                json_t* reason = json_object_get(run, "reason");
+                attempt.finished = json_is_string(reason) && strcmp(json_string_value(reason), "FINISHED") == 0;
+                if (!json_object_get(run, "date")) {
+                    // The date is in the name, between "run_" and ".json"
+                    json_object_set_new(run, "date", json_stringn(names[i] + 4, strlen(names[i]) - 9));
+                }
+                if (ls_history_append(game->path, run, &attempt) == 0) {
+                    imported++;
+                }
+            }
+            if (run) {
+                json_decref(run);
+            }
+        }
+        free(names[i]);
+    }
+    free(names);
+
+    // Create the log even if there was nothing to import, so this isn't done again
+    int log_fd = open(log_path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (log_fd >= 0) {
+        close(log_fd);
+    }
+    if (imported) {
+        printf("[history] Imported %d runs into %s\n", imported, log_path);
+    }
+    return imported;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "timer.h"
+
+#include <jansson.h>
+#include <stdint.h>
+
+/**
+ * An entry of the attempt index, pointing to an attempt in the log.
+ */
+typedef struct ls_attempt {
+    uint32_t id; /*!< Number of the attempt in the log, starting at 1 */
+    uint32_t reached_split; /*!< Number of splits done when the attempt ended */
+    uint64_t offset; /*!< Where the attempt starts in the log */
+    int64_t final_time; /*!< Time of the timer when the attempt ended */
+    uint32_t finished; /*!< Non-zero if the run was finished instead of reset */
+    uint32_t reserved;
+} ls_attempt;
+
+/**
+ * Called for every attempt of the log, in the order they were made.
+ */
+typedef void (*ls_history_callback)(const ls_attempt* attempt, json_t* run, void* data);
+
+/**
+ * Called for every attempt of the log with its line of JSON, not parsed.
+ */
+typedef void (*ls_history_line_callback)(const ls_attempt* attempt, const char* line, void* data);
+
+bool ls_history_file_path(const char* split_path, const char* extension, char* path);
+bool ls_history_run_matches(const ls_game* game, json_t* run);
+int ls_history_append(const char* split_path, json_t* run, ls_attempt* attempt);
+uint32_t ls_history_count(const char* split_path);
+bool ls_history_get(const char* split_path, uint32_t id, ls_attempt* attempt);
+json_t* ls_history_load(const char* split_path, const ls_attempt* attempt);
+int ls_history_foreach_line(const char* split_path, uint32_t first_id, ls_history_line_callback callback, void* data);
+int ls_history_foreach(const char* split_path, ls_history_callback callback, void* data);
+int ls_history_import(const ls_game* game);
@@ -3,4 +3,4 @@
 
 extern void timer_stop_reset(LSAppWindow* win);
 
-void process_delayed_handlers(LSAppWindow* win);
+gboolean process_delayed_handlers(gpointer data);
@@ -2,10 +2,17 @@
 #include "delayed_callbacks.h"
 #include "src/gui/app_window.h"
 
-void process_delayed_handlers(LSAppWindow* win)
+/**
+ * Runs the handlers delayed by the keybinds, from an idle callback.
+ *
+ * @param data Pointer to the LibreSplit window.
+ */
+gboolean process_delayed_handlers(gpointer data)
 {
+    LSAppWindow* win = data;
     if (win->delayed_handlers.stop_reset) {
         timer_stop_reset(win);
         win->delayed_handlers.stop_reset = false;
     }
+    return G_SOURCE_REMOVE;
 }
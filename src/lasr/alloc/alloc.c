@@ -0,0 +1,187 @@
+#include "alloc.h"
+
+#include <lauxlib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+LasrAllocStats lasr_alloc_stats = { 0 };
+
+// Small Lua objects (strings, tables, closures) are served from per-size-class free lists
+// carved out of big slabs, so the hot path never reaches malloc and freed objects are reused
+// instead of fragmenting the heap. Anything bigger goes straight to the system allocator.
+typedef struct FreeBlock {
+    struct FreeBlock* next;
+} FreeBlock;
+
+typedef struct Slab {
+    struct Slab* next;
+    size_t used;
+    _Alignas(16) unsigned char data[];
+} Slab;
+
+static FreeBlock* free_lists[LASR_ALLOC_CLASSES] = { NULL }; // Free blocks of each size class
+static Slab* slabs = NULL; // Every slab, the head is the one being carved
+
+/**
+ * Maps an allocation size to its size class.
+ *
+ * @param size The requested size, at most LASR_ALLOC_MAX_POOLED.
+ *
+ * @return The index of the smallest class that fits the size.
+ */
+static int size_class(size_t size)
+{
+    int index = 0;
+    size_t class_size = 16;
+    while (class_size < size) {
+        class_size <<= 1;
+        index++;
+    }
+    return index;
+}
+
+/**
+ * Takes a block of the given size class, carving a new slab if needed.
+ *
+ * @param index The size class.
+ *
+ * @return The block, or NULL if memory is exhausted.
+ */
+static void* pool_take(int index)
+{
+    FreeBlock* block = free_lists[index];
+    if (block) {
+        free_lists[index] = block->next;
+        return block;
+    }
+
+    size_t class_size = (size_t)16 << index;
+    if (!slabs || slabs->used + class_size > LASR_ALLOC_SLAB_SIZE) {
+        Slab* slab = malloc(sizeof(Slab) + LASR_ALLOC_SLAB_SIZE);
+        if (!slab) {
+            return NULL;
+        }
+        slab->used = 0;
+        slab->next = slabs;
+        slabs = slab;
+        lasr_alloc_stats.pooled += LASR_ALLOC_SLAB_SIZE;
+    }
+
+    void* ptr = slabs->data + slabs->used;
+    slabs->used += class_size;
+    return ptr;
+}
+
+/**
+ * Gives a block back to the free list of its size class.
+ *
+ * @param index The size class.
+ * @param ptr The block.
+ */
+static void pool_give(int index, void* ptr)
+{
+    FreeBlock* block = ptr;
+    block->next = free_lists[index];
+    free_lists[index] = block;
+}
+
+/**
+ * lua_Alloc implementation backing the LASR Lua state.
+ *
+ * @param ud Unused.
+ * @param ptr The block to reallocate or free, NULL for a new allocation.
+ * @param osize The current size of the block.
+ * @param nsize The requested size, zero to free the block.
+ *
+ * @return The new block, or NULL if it was freed or memory is exhausted.
+ */
+static void* lasr_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    (void)ud;
+    bool old_pooled = ptr && osize <= LASR_ALLOC_MAX_POOLED;
+    bool new_pooled = nsize <= LASR_ALLOC_MAX_POOLED;
+
+    if (nsize == 0) {
+        if (ptr) {
+            if (old_pooled) {
+                pool_give(size_class(osize), ptr);
+            } else {
+                free(ptr);
+            }
+            lasr_alloc_stats.in_use -= osize;
+            lasr_alloc_stats.frees++;
+        }
+        return NULL;
+    }
+
+    void* block;
+    if (ptr && old_pooled && new_pooled && size_class(osize) == size_class(nsize)) {
+        // Same size class, the block already fits
+        block = ptr;
+    } else if (ptr && !old_pooled && !new_pooled) {
+        block = realloc(ptr, nsize);
+        if (!block) {
+            return NULL;
+        }
+    } else {
+        block = new_pooled ? pool_take(size_class(nsize)) : malloc(nsize);
+        if (!block) {
+            return NULL;
+        }
+        if (ptr) {
+            memcpy(block, ptr, osize < nsize ? osize : nsize);
+            if (old_pooled) {
+                pool_give(size_class(osize), ptr);
+            } else {
+                free(ptr);
+            }
+        }
+    }
+
+    if (ptr) {
+        lasr_alloc_stats.in_use -= osize;
+    } else {
+        lasr_alloc_stats.allocations++;
+    }
+    lasr_alloc_stats.in_use += nsize;
+    if (lasr_alloc_stats.in_use > lasr_alloc_stats.peak) {
+        lasr_alloc_stats.peak = lasr_alloc_stats.in_use;
+    }
+    return block;
+}
+
+/**
+ * Creates a Lua state backed by the pooled allocator.
+ *
+ * LuaJIT builds without GC64 refuse custom allocators on 64-bit, in that case
+ * the state falls back to the default allocator and the counters stay at zero.
+ *
+ * @return The new Lua state, or NULL if it could not be created.
+ */
+lua_State* lasr_alloc_newstate(void)
+{
+    memset(&lasr_alloc_stats, 0, sizeof(lasr_alloc_stats));
+    lua_State* L = lua_newstate(lasr_alloc, NULL);
+    if (!L) {
+        lasr_alloc_destroy();
+        L = luaL_newstate();
+    }
+    return L;
+}
+
+/**
+ * Releases the slabs of the pooled allocator.
+ *
+ * Must only be called after the Lua state has been closed.
+ */
+void lasr_alloc_destroy(void)
+{
+    while (slabs) {
+        Slab* next = slabs->next;
+        free(slabs);
+        slabs = next;
+    }
+    memset(free_lists, 0, sizeof(free_lists));
+    lasr_alloc_stats.pooled = 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <lua.h>
+#include <stddef.h>
+
+#define LASR_ALLOC_CLASSES 6 // 16, 32, 64, 128, 256 and 512 bytes
+#define LASR_ALLOC_MAX_POOLED 512
+#define LASR_ALLOC_SLAB_SIZE (64 * 1024)
+
+/**
+ * Allocation counters of the LASR Lua state.
+ */
+typedef struct LasrAllocStats {
+    size_t in_use; /*!< Bytes currently handed out to Lua */
+    size_t peak; /*!< Highest value in_use reached */
+    size_t pooled; /*!< Bytes reserved in slabs for the small size classes */
+    size_t allocations; /*!< Number of allocations */
+    size_t frees; /*!< Number of frees */
+} LasrAllocStats;
+
+extern LasrAllocStats lasr_alloc_stats;
+
+lua_State* lasr_alloc_newstate(void);
+void lasr_alloc_destroy(void);
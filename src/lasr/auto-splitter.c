@@ -4,7 +4,15 @@
  */
 #include "auto-splitter.h"
 
+#include "./alloc/alloc.h"
+#include "./bytecode/bytecode.h"
+#include "./int64/int64.h"
 #include "./maps/maps.h"
+#include "./memory.h"
+#include "./profiler/profiler.h"
+#include "./replay/replay.h"
+#include "./snapshot/snapshot.h"
+#include "./types.h"
 #include "functions.h"
 #include "utils.h"
 
@@ -15,6 +23,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -22,6 +31,7 @@
 char auto_splitter_file[PATH_MAX]; /*!< The loaded auto splitter file path */
 int refresh_rate = 60; /*!< The Auto Splitter's refresh rate applied */
 bool use_game_time = false; /*!< Enables IGT */
+bool auto_splitter_reloading = false; /*!< True while a hot reload re-executes the script */
 atomic_bool update_game_time = false; /*!< True if the auto splitter is requesting the game time to be updated */
 atomic_llong game_time_value = 0; /*!< The in-game time value, in milliseconds */
 
@@ -37,6 +47,13 @@ int maps_cache_cycles = 1;
  */
 int maps_cache_cycles_value = 1; /*!< The number of cycles the cache is active for */
 
+/**
+ * Maximum time, in microseconds, spent on incremental garbage collection in each tick.
+ *
+ * The collector only runs in the time left before the next tick, this is the upper bound.
+ */
+int gc_step_budget = 1000;
+
 atomic_bool auto_splitter_enabled = true; /*!< Defines if the auto splitter is enabled */
 atomic_bool auto_splitter_running = false; /*!< Defines if the auto splitter is running */
 atomic_bool call_start = false; /*!< True if the auto splitter is requesting for a run to start */
@@ -47,6 +64,8 @@ atomic_bool toggle_loading = false;
 atomic_bool call_reset = false; /*!< True if the auto splitter is requesting a run reset */
 bool prev_is_loading; /*!< The previous frame "is_loading" state */
 
+static void (*request_notify)(void) = NULL; /*!< Wakes the timer up when a request is made */
+
 /**
  * Disable possibly dangerous functions in LASR.
  */
@@ -76,6 +95,9 @@ static const char* disabled_functions[] = {
  */
 int process_exists()
 {
+    if (replay_mode == REPLAY_REPLAYING) {
+        return !replay_finished();
+    }
     int result = kill(process.pid, 0);
     return result == 0;
 }
@@ -101,8 +123,15 @@ static const lasr_function luac_functions[] = {
     { "process", find_process_id },
     { "getBaseAddress", getBaseAddress },
     { "readAddress", readAddress },
+    { "defineStruct", defineStruct },
+    { "readStruct", readStruct },
+    { "readArray", readArray },
+    { "addSnapshotRegion", addSnapshotRegion },
+    { "removeSnapshotRegion", removeSnapshotRegion },
     { "sizeOf", size_of },
     { "sig_scan", perform_sig_scan },
+    { "sig_scan_async", sig_scan_async },
+    { "compileSignature", compileSignature },
     { "getPID", getPID },
     { "getModuleSize", getModuleSize },
     { "shallow_copy_tbl", shallow_copy_tbl },
@@ -114,6 +143,7 @@ static const lasr_function luac_functions[] = {
     { "b_lshift", b_lshift },
     { "b_rshift", b_rshift },
     { "getMaps", getMaps },
+    { "getMemoryStats", getMemoryStats },
     { NULL, NULL }
 };
 
@@ -306,6 +336,12 @@ void startup(lua_State* L)
         use_game_time = lua_toboolean(L, -1);
     }
     lua_pop(L, 1); // Remove 'useGameTime' from the stack
+
+    lua_getglobal(L, "gcStepBudget");
+    if (lua_isnumber(L, -1)) {
+        gc_step_budget = lua_tointeger(L, -1);
+    }
+    lua_pop(L, 1); // Remove 'gcStepBudget' from the stack
 }
 
 /**
@@ -332,6 +368,28 @@ void update(lua_State* L)
     call_va(L, "update", "");
 }
 
+/**
+ * Sets the function called every time the auto splitter makes a request to the timer.
+ *
+ * It's called from the auto splitter thread, and must be set before the thread starts.
+ *
+ * @param notify The function, or NULL to not be notified.
+ */
+void auto_splitter_set_notify(void (*notify)(void))
+{
+    request_notify = notify;
+}
+
+/**
+ * Tells the timer a request was made through call_start, call_split, ...
+ */
+void auto_splitter_notify(void)
+{
+    if (request_notify) {
+        request_notify();
+    }
+}
+
 /**
  * The start() LASR function.
  *
@@ -347,6 +405,7 @@ void start(lua_State* L)
         atomic_store(&call_start, ret);
         if (ret) {
             atomic_store(&run_started, true);
+            auto_splitter_notify();
         }
     }
     lua_pop(L, 1); // Remove the return value from the stack
@@ -364,6 +423,9 @@ void split(lua_State* L)
     bool ret;
     if (call_va(L, "split", ">b", &ret)) {
         atomic_store(&call_split, ret);
+        if (ret) {
+            auto_splitter_notify();
+        }
     }
     lua_pop(L, 1); // Remove the return value from the stack
 }
@@ -383,6 +445,7 @@ void is_loading(lua_State* L)
         if (loading != prev_is_loading) {
             atomic_store(&toggle_loading, true);
             prev_is_loading = !prev_is_loading;
+            auto_splitter_notify();
         }
     }
     lua_pop(L, 1); // Remove the return value from the stack
@@ -400,8 +463,10 @@ void reset(lua_State* L)
 {
     bool shouldReset;
     if (call_va(L, "reset", ">b", &shouldReset)) {
-        if (shouldReset)
+        if (shouldReset) {
             atomic_store(&call_reset, true);
+            auto_splitter_notify();
+        }
     }
     lua_pop(L, 1); // Remove the return value from the stack
 }
@@ -421,84 +486,375 @@ void gameTime(lua_State* L)
         // Convert gameTime from milliseconds to the expected time format and update the timer
         atomic_store(&game_time_value, (long long)gameTime * 1000);
         atomic_store(&update_game_time, true);
+        auto_splitter_notify();
     }
     lua_pop(L, 1); // Remove the return value from the stack
 }
 
 /**
- * Loads the auto splitter Lua file and executes the auto splitter.
+ * Gets the time elapsed since a point in time.
+ *
+ * @param since The starting point, from CLOCK_MONOTONIC.
+ *
+ * @return The elapsed time in microseconds.
  */
-void run_auto_splitter()
+static long long elapsed_us(const struct timespec* since)
 {
-    lua_State* L = luaL_newstate();
-    luaL_openlibs(L);
-    disable_functions(L, disabled_functions);
-    push_lasr_functions(L, luac_functions);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000 + (now.tv_nsec - since->tv_nsec) / 1000;
+}
 
-    char current_file[PATH_MAX];
-    strcpy(current_file, auto_splitter_file);
+/**
+ * Runs a LASR callback, recording its duration in the profiler.
+ *
+ * @param L The Lua State
+ * @param section The profiler section of the callback.
+ * @param callback The callback to run.
+ */
+static void profile_callback(lua_State* L, ProfilerSection section, void (*callback)(lua_State*))
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    callback(L);
+    profiler_record(section, elapsed_us(&start));
+}
+
+/**
+ * Incremental garbage collection state of the LASR Lua state.
+ */
+typedef struct lasr_gc {
+    bool cycle_running; /*!< True if a collection cycle was started and hasn't finished yet */
+    int live_kb; /*!< Memory in use, in KB, when the last cycle finished */
+} lasr_gc;
+
+/**
+ * Runs incremental garbage collection steps in the slack time of a tick.
+ *
+ * A new cycle starts once the memory in use doubled since the previous one finished,
+ * then steps run until the cycle is done or the time budget is spent. The automatic
+ * collector is left with a high pause, so it only takes over if the slack time
+ * is not enough to keep up with the script allocations.
+ *
+ * @param L The Lua State
+ * @param gc The collector state.
+ * @param clock_start The start of the current tick.
+ * @param rate The tick duration, in microseconds.
+ */
+static void gc_step(lua_State* L, lasr_gc* gc, const struct timespec* clock_start, long long rate)
+{
+    if (!gc->cycle_running) {
+        if (lua_gc(L, LUA_GCCOUNT, 0) < gc->live_kb * 2) {
+            return;
+        }
+        gc->cycle_running = true;
+    }
+
+    long long deadline = rate - elapsed_us(clock_start);
+    if (deadline > gc_step_budget) {
+        deadline = gc_step_budget;
+    }
+    struct timespec step_start;
+    clock_gettime(CLOCK_MONOTONIC, &step_start);
+
+    // Always do one step, so the cycle makes progress even on busy ticks
+    do {
+        if (lua_gc(L, LUA_GCSTEP, 0)) {
+            gc->cycle_running = false;
+            gc->live_kb = lua_gc(L, LUA_GCCOUNT, 0);
+            break;
+        }
+    } while (elapsed_us(&step_start) < deadline);
+}
+
+/**
+ * The callbacks defined by the currently loaded auto splitter.
+ */
+typedef struct lasr_callbacks {
+    bool state; /*!< True if state() is defined */
+    bool start; /*!< True if start() is defined */
+    bool split; /*!< True if split() is defined */
+    bool is_loading; /*!< True if isLoading() is defined */
+    bool startup; /*!< True if startup() is defined */
+    bool reset; /*!< True if reset() is defined */
+    bool update; /*!< True if update() is defined */
+    bool game_time; /*!< True if gameTime() is defined */
+} lasr_callbacks;
+
+/**
+ * The globals holding the LASR callbacks.
+ */
+static const char* callback_names[] = {
+    "state",
+    "startup",
+    "update",
+    "start",
+    "split",
+    "isLoading",
+    "gameTime",
+    "reset",
+};
+
+#define CALLBACK_COUNT (int)(sizeof(callback_names) / sizeof(callback_names[0]))
+
+/**
+ * Checks whether a global function is defined in the Lua state.
+ *
+ * @param L The Lua State
+ * @param name The name of the global function
+ *
+ * @return True if the global exists and is a function.
+ */
+static bool function_exists(lua_State* L, const char* name)
+{
+    lua_getglobal(L, name);
+    bool exists = lua_isfunction(L, -1);
+    lua_pop(L, 1); // Remove the global from the stack
+    return exists;
+}
+
+/**
+ * Looks up which LASR callbacks the loaded auto splitter defines.
+ *
+ * @param L The Lua State
+ * @param callbacks The callbacks struct to fill.
+ */
+static void find_callbacks(lua_State* L, lasr_callbacks* callbacks)
+{
+    callbacks->state = function_exists(L, "state");
+    callbacks->start = function_exists(L, "start");
+    callbacks->split = function_exists(L, "split");
+    callbacks->is_loading = function_exists(L, "isLoading");
+    callbacks->startup = function_exists(L, "startup");
+    callbacks->reset = function_exists(L, "reset");
+    callbacks->update = function_exists(L, "update");
+    callbacks->game_time = function_exists(L, "gameTime");
+}
 
-    // Load the Lua file
-    if (luaL_loadfile(L, auto_splitter_file) != LUA_OK) {
+/**
+ * Compiles an auto splitter chunk, pushing it on the stack of the Lua state.
+ *
+ * @param L The Lua State
+ * @param path The path of the Lua file to load.
+ *
+ * @return True if the chunk was compiled, false if it has a syntax error.
+ */
+static bool compile_auto_splitter(lua_State* L, const char* path)
+{
+    // Load the Lua file, or its cached bytecode
+    if (bytecode_loadfile(L, path) != LUA_OK) {
         // Error loading the file
         const char* error_msg = lua_tostring(L, -1);
-        lua_pop(L, 1); // Remove the error message from the stack
         fprintf(stderr, "Lua syntax error: %s\n", error_msg);
-        lua_close(L);
-        atomic_store(&auto_splitter_enabled, false);
-        return;
+        lua_pop(L, 1); // Remove the error message from the stack
+        return false;
     }
+    return true;
+}
 
-    // Execute the Lua file
-    if (lua_pcall(L, 0, LUA_MULTRET, 0) != LUA_OK) {
+/**
+ * Executes the chunk pushed by compile_auto_splitter, popping it.
+ *
+ * @param L The Lua State
+ *
+ * @return True if the chunk was executed without errors.
+ */
+static bool execute_auto_splitter(lua_State* L)
+{
+    if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
         // Error executing the file
         const char* error_msg = lua_tostring(L, -1);
-        lua_pop(L, 1); // Remove the error message from the stack
         fprintf(stderr, "Lua runtime error: %s\n", error_msg);
-        lua_close(L);
-        atomic_store(&auto_splitter_enabled, false);
-        return;
+        lua_pop(L, 1); // Remove the error message from the stack
+        return false;
     }
+    return true;
+}
+
+/**
+ * Loads and executes an auto splitter chunk in the given Lua state.
+ *
+ * @param L The Lua State
+ * @param path The path of the Lua file to load.
+ *
+ * @return True if the chunk was loaded and executed without errors.
+ */
+static bool load_auto_splitter(lua_State* L, const char* path)
+{
+    return compile_auto_splitter(L, path) && execute_auto_splitter(L);
+}
 
-    lua_getglobal(L, "state");
-    bool state_exists = lua_isfunction(L, -1);
-    lua_pop(L, 1); // Remove 'state' from the stack
+/**
+ * Starts watching the auto splitter file for changes.
+ *
+ * The parent directory is watched instead of the file itself, so that
+ * editors that save by renaming a temporary file over the original
+ * are detected too.
+ *
+ * @param path The path of the auto splitter file.
+ *
+ * @return A non-blocking inotify file descriptor, or -1 on failure.
+ */
+static int watch_auto_splitter(const char* path)
+{
+    char directory[PATH_MAX];
+    strncpy(directory, path, sizeof(directory) - 1);
+    directory[sizeof(directory) - 1] = '\0';
+    char* last_slash = strrchr(directory, '/');
+    if (last_slash == NULL) {
+        strcpy(directory, ".");
+    } else if (last_slash == directory) {
+        last_slash[1] = '\0';
+    } else {
+        *last_slash = '\0';
+    }
 
-    lua_getglobal(L, "start");
-    bool start_exists = lua_isfunction(L, -1);
-    lua_pop(L, 1); // Remove 'start' from the stack
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        perror("Failed to initialize auto splitter hot reload");
+        return -1;
+    }
+    if (inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        perror("Failed to watch the auto splitter directory");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
 
-    lua_getglobal(L, "split");
-    bool split_exists = lua_isfunction(L, -1);
-    lua_pop(L, 1); // Remove 'split' from the stack
+/**
+ * Drains the pending inotify events, checking if the auto splitter file changed.
+ *
+ * @param fd The inotify file descriptor returned by watch_auto_splitter.
+ * @param file_name The base name of the auto splitter file.
+ *
+ * @return True if at least one event refers to the auto splitter file.
+ */
+static bool auto_splitter_changed(int fd, const char* file_name)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t len;
 
-    lua_getglobal(L, "isLoading");
-    bool is_loading_exists = lua_isfunction(L, -1);
-    lua_pop(L, 1); // Remove 'isLoading' from the stack
+    if (fd < 0) {
+        return false;
+    }
 
-    lua_getglobal(L, "startup");
-    bool startup_exists = lua_isfunction(L, -1);
-    lua_pop(L, 1); // Remove 'startup' from the stack
+    while ((len = read(fd, buffer, sizeof(buffer))) > 0) {
+        const struct inotify_event* event;
+        for (char* ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event*)ptr;
+            if (event->len && strcmp(event->name, file_name) == 0) {
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+/**
+ * Re-executes the auto splitter chunk in the running Lua state.
+ *
+ * The attached process, the maps cache and the signature scan results are
+ * kept, so the new callbacks take over on the next tick without going
+ * through process discovery again. The callbacks are cleared before the
+ * chunk runs, so the ones it no longer defines stop being called. If the new
+ * chunk fails to load, the previous callbacks and snapshot regions are kept.
+ *
+ * @param L The Lua State
+ * @param path The path of the auto splitter file.
+ * @param callbacks The callbacks struct to update.
+ */
+static void reload_auto_splitter(lua_State* L, const char* path, lasr_callbacks* callbacks)
+{
+    int i;
+    printf("Auto splitter changed, reloading %s\n", path);
+    if (!compile_auto_splitter(L, path)) {
+        printf("Reload failed, keeping the previous auto splitter callbacks\n");
+        return;
+    }
+
+    // Callbacks removed from the script must not survive the reload, keep them aside
+    // until the new chunk has run
+    lua_newtable(L);
+    for (i = 0; i < CALLBACK_COUNT; i++) {
+        lua_getglobal(L, callback_names[i]);
+        lua_setfield(L, -2, callback_names[i]);
+        lua_pushnil(L);
+        lua_setglobal(L, callback_names[i]);
+    }
+    lua_insert(L, -2); // Below the chunk
+    // The new script declares its own regions
+    snapshot_stash();
+
+    // The process and the signature scans of the previous version are reused meanwhile
+    auto_splitter_reloading = true;
+    bool loaded = execute_auto_splitter(L);
+    if (!loaded) {
+        for (i = 0; i < CALLBACK_COUNT; i++) {
+            lua_getfield(L, -1, callback_names[i]);
+            lua_setglobal(L, callback_names[i]);
+        }
+    }
+    lua_pop(L, 1); // Remove the previous callbacks from the stack
+    snapshot_unstash(!loaded);
+    if (!loaded) {
+        auto_splitter_reloading = false;
+        printf("Reload failed, keeping the previous auto splitter callbacks\n");
+        return;
+    }
+    find_callbacks(L, callbacks);
+    if (callbacks->startup) {
+        startup(L);
+    }
+    auto_splitter_reloading = false;
+}
+
+/**
+ * Loads the auto splitter Lua file and executes the auto splitter.
+ */
+void run_auto_splitter()
+{
+    lua_State* L = lasr_alloc_newstate();
+    luaL_openlibs(L);
+    disable_functions(L, disabled_functions);
+    push_lasr_functions(L, luac_functions);
+    lasr_push_types(L);
+    int64_register(L);
+    sig_scan_register(L);
+    sig_scan_cache_clear();
+    profiler_reset();
+    replay_open();
 
-    lua_getglobal(L, "reset");
-    bool reset_exists = lua_isfunction(L, -1);
-    lua_pop(L, 1); // Remove 'reset' from the stack
+    char current_file[PATH_MAX];
+    strcpy(current_file, auto_splitter_file);
 
-    lua_getglobal(L, "update");
-    bool update_exists = lua_isfunction(L, -1);
-    lua_pop(L, 1); // Remove 'update' from the stack
+    if (!load_auto_splitter(L, current_file)) {
+        replay_close();
+        lua_close(L);
+        lasr_alloc_destroy();
+        atomic_store(&auto_splitter_enabled, false);
+        return;
+    }
 
-    lua_getglobal(L, "gameTime");
-    bool gameTime_exists = lua_isfunction(L, -1);
-    lua_pop(L, 1); // Remove 'gameTime' from the stack
+    lasr_callbacks callbacks;
+    find_callbacks(L, &callbacks);
 
-    if (startup_exists) {
+    if (callbacks.startup) {
         startup(L);
     }
 
     printf("Refresh rate: %d\n", refresh_rate);
     int rate = 1000000 / refresh_rate;
 
+    // Collection is driven by gc_step, the automatic collector is only a fallback
+    lasr_gc gc = { .cycle_running = false, .live_kb = lua_gc(L, LUA_GCCOUNT, 0) };
+    lua_gc(L, LUA_GCSETPAUSE, 400);
+
+    const char* file_name = strrchr(current_file, '/');
+    file_name = file_name ? file_name + 1 : current_file;
+    int watch_fd = watch_auto_splitter(current_file);
+
     while (1) {
         struct timespec clock_start;
         clock_gettime(CLOCK_MONOTONIC, &clock_start);
@@ -507,34 +863,44 @@ void run_auto_splitter()
             break;
         }
 
-        if (state_exists) {
-            state(L);
+        if (!replay_tick()) {
+            break;
+        }
+        snapshot_tick();
+
+        // Swap the callbacks between ticks if the script was edited
+        if (auto_splitter_changed(watch_fd, file_name)) {
+            reload_auto_splitter(L, current_file, &callbacks);
+            rate = 1000000 / refresh_rate;
         }
 
-        if (update_exists) {
-            update(L);
+        if (callbacks.state) {
+            profile_callback(L, PROFILE_STATE, state);
         }
 
-        if (gameTime_exists && use_game_time && atomic_load(&run_started) && !atomic_load(&run_finished)) {
-            gameTime(L);
+        if (callbacks.update) {
+            profile_callback(L, PROFILE_UPDATE, update);
         }
 
-        if (start_exists && !atomic_load(&run_started) && !atomic_load(&run_finished)) {
-            start(L);
+        if (callbacks.game_time && use_game_time && atomic_load(&run_started) && !atomic_load(&run_finished)) {
+            profile_callback(L, PROFILE_GAME_TIME, gameTime);
         }
 
-        if (split_exists && atomic_load(&run_started)) {
-            split(L);
+        if (callbacks.start && !atomic_load(&run_started) && !atomic_load(&run_finished)) {
+            profile_callback(L, PROFILE_START, start);
         }
 
-        if (is_loading_exists) {
-            is_loading(L);
+        if (callbacks.split && atomic_load(&run_started)) {
+            profile_callback(L, PROFILE_SPLIT, split);
         }
 
-        if (reset_exists) {
-            reset(L);
+        if (callbacks.is_loading) {
+            profile_callback(L, PROFILE_IS_LOADING, is_loading);
         }
 
+        if (callbacks.reset) {
+            profile_callback(L, PROFILE_RESET, reset);
+        }
         // Clear the memory maps cache if needed
         maps_cache_cycles_value--;
         if (maps_cache_cycles_value < 1) {
@@ -543,14 +909,30 @@ void run_auto_splitter()
             // printf("Cleared maps cache\n");
         }
 
-        struct timespec clock_end;
-        clock_gettime(CLOCK_MONOTONIC, &clock_end);
-        long long duration = (clock_end.tv_sec - clock_start.tv_sec) * 1000000 + (clock_end.tv_nsec - clock_start.tv_nsec) / 1000;
-        // printf("duration: %llu\n", duration);
-        if (duration < rate) {
+        struct timespec gc_start;
+        clock_gettime(CLOCK_MONOTONIC, &gc_start);
+        gc_step(L, &gc, &clock_start, rate);
+        profiler_record(PROFILE_GC, elapsed_us(&gc_start));
+
+        long long duration = elapsed_us(&clock_start);
+        profiler_tick_end(duration);
+        // Replays run as fast as possible
+        if (duration < rate && replay_mode != REPLAY_REPLAYING) {
             usleep(rate - duration);
         }
     }
 
+    if (replay_finished()) {
+        // Stop here instead of replaying the same recording again
+        atomic_store(&auto_splitter_enabled, false);
+    }
+    sig_scan_async_shutdown();
+    replay_close();
+    snapshot_clear();
+    memory_detach();
+    if (watch_fd >= 0) {
+        close(watch_fd);
+    }
     lua_close(L);
+    lasr_alloc_destroy();
 }
@@ -7,6 +7,7 @@
 extern char auto_splitter_file[PATH_MAX];
 extern int refresh_rate;
 extern bool use_game_time;
+extern bool auto_splitter_reloading;
 extern atomic_bool update_game_time;
 extern atomic_llong game_time_value;
 extern int maps_cache_cycles;
@@ -29,4 +30,7 @@ struct lasr_function {
 } typedef lasr_function;
 
 void check_directories();
+int process_exists();
 void run_auto_splitter();
+void auto_splitter_set_notify(void (*notify)(void));
+void auto_splitter_notify(void);
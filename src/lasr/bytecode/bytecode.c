@@ -0,0 +1,316 @@
+#include "bytecode.h"
+
+#include "src/settings/utils.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <lauxlib.h>
+#include <linux/limits.h>
+#include <luajit.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Compiled auto splitters are kept in <libresplit folder>/cache/<hash>.ljbc, where the hash is
+// the one of the script path, so saving a script replaces its entry. Each file starts with a
+// header, followed by the source it was compiled from and the bytecode: LuaJIT doesn't verify
+// bytecode, so it's only loaded when the source is identical, the LuaJIT version matches and
+// the bytecode checksum is intact. Cached files are only ever loaded in binary mode and sources
+// only in text mode, scripts themselves still have no way to load bytecode.
+
+#define BYTECODE_MAGIC "LSBC"
+#define BYTECODE_VERSION 1
+#define BYTECODE_CACHE_MAX_FILES 32 // Entries kept, the least recently written are removed
+
+/**
+ * The header of a cached file.
+ */
+typedef struct BytecodeHeader {
+    char magic[4]; /*!< BYTECODE_MAGIC */
+    uint32_t version; /*!< BYTECODE_VERSION */
+    char luajit_version[32]; /*!< The LuaJIT that compiled the bytecode */
+    uint64_t source_size; /*!< Size of the source following the header */
+    uint64_t bytecode_size; /*!< Size of the bytecode following the source */
+    uint64_t bytecode_hash; /*!< FNV-1a hash of the bytecode, to catch damaged files */
+} BytecodeHeader;
+
+/**
+ * Bytecode dumped by lua_dump.
+ */
+typedef struct BytecodeBuffer {
+    char* data;
+    size_t size;
+    size_t capacity;
+} BytecodeBuffer;
+
+/**
+ * Reads a whole file into memory.
+ *
+ * @param path The path of the file.
+ * @param size Where to store the size of the file.
+ *
+ * @return A malloc'd buffer with the file contents, or NULL on error.
+ */
+static char* read_file(const char* path, size_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+
+    char* buffer = NULL;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        long length = ftell(f);
+        if (length >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+            buffer = malloc(length ? length : 1);
+            if (buffer && fread(buffer, 1, length, f) != (size_t)length) {
+                free(buffer);
+                buffer = NULL;
+            }
+            *size = length;
+        }
+    }
+    fclose(f);
+    return buffer;
+}
+
+/**
+ * Computes the 64 bit FNV-1a hash of a buffer.
+ *
+ * @param hash The starting hash, to chain multiple buffers.
+ * @param data The buffer.
+ * @param size The size of the buffer.
+ *
+ * @return The hash.
+ */
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * lua_Writer that appends the dumped bytecode to a buffer.
+ */
+static int write_bytecode(lua_State* L, const void* p, size_t sz, void* ud)
+{
+    (void)L;
+    BytecodeBuffer* buffer = ud;
+    if (buffer->size + sz > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (capacity < buffer->size + sz) {
+            capacity *= 2;
+        }
+        char* data = realloc(buffer->data, capacity);
+        if (!data) {
+            return 1;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, p, sz);
+    buffer->size += sz;
+    return 0;
+}
+
+/**
+ * Fills the header expected for a source, without the bytecode fields.
+ */
+static void init_header(BytecodeHeader* header, size_t source_size)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, BYTECODE_MAGIC, sizeof(header->magic));
+    header->version = BYTECODE_VERSION;
+    strncpy(header->luajit_version, LUAJIT_VERSION, sizeof(header->luajit_version) - 1);
+    header->source_size = source_size;
+}
+
+/**
+ * Finds the bytecode of a cached file, if it was compiled from the given source.
+ *
+ * @param file The contents of the cached file.
+ * @param file_size The size of the cached file.
+ * @param source The source of the auto splitter.
+ * @param source_size The size of the source.
+ * @param[out] bytecode_size The size of the bytecode.
+ *
+ * @return The bytecode inside the file, or NULL if the file doesn't match the source or is damaged.
+ */
+static const char* cached_bytecode(const char* file, size_t file_size, const char* source, size_t source_size, size_t* bytecode_size)
+{
+    BytecodeHeader expected;
+    BytecodeHeader header;
+    init_header(&expected, source_size);
+    if (file_size < sizeof(header)) {
+        return NULL;
+    }
+    memcpy(&header, file, sizeof(header));
+    if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+        || header.version != expected.version
+        || memcmp(header.luajit_version, expected.luajit_version, sizeof(header.luajit_version)) != 0
+        || header.source_size != source_size
+        || file_size - sizeof(header) < source_size
+        || file_size - sizeof(header) - source_size != header.bytecode_size) {
+        return NULL;
+    }
+    const char* cached_source = file + sizeof(header);
+    const char* bytecode = cached_source + source_size;
+    if (memcmp(cached_source, source, source_size) != 0
+        || fnv1a(0xcbf29ce484222325ULL, bytecode, header.bytecode_size) != header.bytecode_hash) {
+        return NULL;
+    }
+    *bytecode_size = header.bytecode_size;
+    return bytecode;
+}
+
+/**
+ * Removes the oldest cached files, keeping at most BYTECODE_CACHE_MAX_FILES.
+ *
+ * @param cache_folder The path of the cache folder.
+ */
+static void prune_cache(const char* cache_folder)
+{
+    DIR* dir = opendir(cache_folder);
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    int count = 0;
+    char oldest_path[PATH_MAX] = "";
+    time_t oldest_time = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* extension = strrchr(entry->d_name, '.');
+        if (!extension || strcmp(extension, ".ljbc") != 0) {
+            continue;
+        }
+        char path[PATH_MAX];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", cache_folder, entry->d_name);
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        if (!count++ || st.st_mtime < oldest_time) {
+            oldest_time = st.st_mtime;
+            strcpy(oldest_path, path);
+        }
+    }
+    closedir(dir);
+    // Called after every save, so there's at most one file over the limit
+    if (count > BYTECODE_CACHE_MAX_FILES) {
+        unlink(oldest_path);
+    }
+}
+
+/**
+ * Saves the function on top of the stack to the cache, along with its source.
+ *
+ * The file is written to a temporary file first, so a crash never leaves
+ * a truncated file behind.
+ *
+ * @param L The Lua state, with the compiled chunk on top of the stack.
+ * @param cache_path The path of the cached file.
+ * @param source The source the chunk was compiled from.
+ * @param source_size The size of the source.
+ */
+static void save_bytecode(lua_State* L, const char* cache_path, const char* source, size_t source_size)
+{
+    BytecodeBuffer bytecode = { NULL, 0, 0 };
+    if (lua_dump(L, write_bytecode, &bytecode) != 0) {
+        free(bytecode.data);
+        return;
+    }
+    BytecodeHeader header;
+    init_header(&header, source_size);
+    header.bytecode_size = bytecode.size;
+    header.bytecode_hash = fnv1a(0xcbf29ce484222325ULL, bytecode.data, bytecode.size);
+
+    char temp_path[PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", cache_path, getpid());
+
+    FILE* f = fopen(temp_path, "wb");
+    if (!f) {
+        free(bytecode.data);
+        return;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, f) == 1
+        && fwrite(source, 1, source_size, f) == source_size
+        && fwrite(bytecode.data, 1, bytecode.size, f) == bytecode.size;
+    free(bytecode.data);
+    if (fclose(f) != 0 || !written || rename(temp_path, cache_path) != 0) {
+        unlink(temp_path);
+        return;
+    }
+
+    char cache_folder[PATH_MAX];
+    strcpy(cache_folder, cache_path);
+    *strrchr(cache_folder, '/') = '\0';
+    prune_cache(cache_folder);
+}
+
+/**
+ * Loads an auto splitter, using the bytecode cache when possible.
+ *
+ * Works like luaL_loadfile, but only accepts Lua source files. On success the compiled
+ * chunk is pushed on the stack, otherwise the error message is.
+ *
+ * @param L The Lua state.
+ * @param path The path of the auto splitter.
+ *
+ * @return LUA_OK on success, a Lua error code otherwise.
+ */
+int bytecode_loadfile(lua_State* L, const char* path)
+{
+    size_t source_size;
+    char* source = read_file(path, &source_size);
+    if (!source) {
+        lua_pushfstring(L, "cannot open %s", path);
+        return LUA_ERRFILE;
+    }
+
+    char chunk_name[PATH_MAX + 1];
+    snprintf(chunk_name, sizeof(chunk_name), "@%s", path);
+
+    // One entry per script, so saving it replaces the previous bytecode
+    char script_path[PATH_MAX];
+    if (!realpath(path, script_path)) {
+        strcpy(script_path, path);
+    }
+    uint64_t hash = fnv1a(0xcbf29ce484222325ULL, script_path, strlen(script_path));
+
+    char cache_path[PATH_MAX];
+    get_libresplit_folder_path(cache_path);
+    size_t folder_length = strlen(cache_path);
+    snprintf(cache_path + folder_length, sizeof(cache_path) - folder_length, "/cache/%016" PRIx64 ".ljbc", hash);
+
+    size_t file_size;
+    char* file = read_file(cache_path, &file_size);
+    if (file) {
+        size_t bytecode_size;
+        const char* bytecode = cached_bytecode(file, file_size, source, source_size, &bytecode_size);
+        int result = bytecode ? luaL_loadbufferx(L, bytecode, bytecode_size, chunk_name, "b") : LUA_ERRFILE;
+        free(file);
+        if (result == LUA_OK) {
+            free(source);
+            return LUA_OK;
+        }
+        // Stale or damaged cache entry, compile the source again and overwrite it
+        if (bytecode) {
+            lua_pop(L, 1);
+        }
+    }
+
+    int result = luaL_loadbufferx(L, source, source_size, chunk_name, "t");
+    if (result == LUA_OK) {
+        save_bytecode(L, cache_path, source, source_size);
+    }
+    free(source);
+    return result;
+}
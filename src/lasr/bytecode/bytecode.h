@@ -0,0 +1,5 @@
+#pragma once
+
+#include <lua.h>
+
+int bytecode_loadfile(lua_State* L, const char* path);
@@ -3,11 +3,15 @@
 #include "functions/bitwise.h"
 #include "functions/getBaseAddress.h"
 #include "functions/getMaps.h"
+#include "functions/getMemoryStats.h"
 #include "functions/getModuleSize.h"
 #include "functions/getPID.h"
 #include "functions/print_tbl.h"
 #include "functions/process.h"
 #include "functions/readAddress.h"
+#include "functions/readArray.h"
+#include "functions/readStruct.h"
 #include "functions/shallow_copy_tbl.h"
 #include "functions/signature.h"
+#include "functions/snapshotRegion.h"
 #include "functions/sizeOf.h"
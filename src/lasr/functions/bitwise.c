@@ -1,7 +1,37 @@
 #include "bitwise.h"
 
+#include "../int64/int64.h"
+
 #include <stdio.h>
 
+/**
+ * Pushes the result of a bitwise operation.
+ *
+ * The result is boxed if any of the arguments was a boxed 64 bit integer, and unsigned
+ * if any of them was unsigned. Otherwise it's a plain number like the arguments.
+ *
+ * @param L the Lua state.
+ * @param result The result.
+ */
+static void push_result(lua_State* L, uint64_t result)
+{
+    bool boxed = false;
+    bool is_unsigned = false;
+    for (int i = 1; i <= lua_gettop(L); i++) {
+        LasrInt64 value;
+        if (int64_is_boxed(L, i) && int64_check(L, i, &value)) {
+            boxed = true;
+            is_unsigned = is_unsigned || value.is_unsigned;
+        }
+    }
+
+    if (boxed) {
+        int64_push(L, result, is_unsigned);
+    } else {
+        lua_pushinteger(L, (lua_Integer)result);
+    }
+}
+
 /**
  * Performs a binary "and" operation between two integers.
  *
@@ -15,18 +45,16 @@ int b_and(lua_State* L)
         return 0;
     }
 
-    if (!lua_isnumber(L, 1) || !lua_isnumber(L, 2)) {
+    LasrInt64 a, b;
+    if (!int64_check(L, 1, &a) || !int64_check(L, 2, &b)) {
         // Arguments are not numbers
         printf("[b_and] Both arguments must be integers");
         return 0;
     }
 
-    lua_Integer a = lua_tointeger(L, 1);
-    lua_Integer b = lua_tointeger(L, 2);
+    uint64_t result = a.bits & b.bits;
 
-    lua_Integer result = a & b;
-
-    lua_pushinteger(L, result);
+    push_result(L, result);
     return 1;
 }
 
@@ -43,18 +71,16 @@ int b_or(lua_State* L)
         return 0;
     }
 
-    if (!lua_isnumber(L, 1) || !lua_isnumber(L, 2)) {
+    LasrInt64 a, b;
+    if (!int64_check(L, 1, &a) || !int64_check(L, 2, &b)) {
         // Arguments are not numbers
         printf("[b_or] Both arguments must be integers");
         return 0;
     }
 
-    lua_Integer a = lua_tointeger(L, 1);
-    lua_Integer b = lua_tointeger(L, 2);
-
-    lua_Integer result = a | b;
+    uint64_t result = a.bits | b.bits;
 
-    lua_pushinteger(L, result);
+    push_result(L, result);
     return 1;
 }
 
@@ -71,18 +97,16 @@ int b_xor(lua_State* L)
         return 0;
     }
 
-    if (!lua_isnumber(L, 1) || !lua_isnumber(L, 2)) {
+    LasrInt64 a, b;
+    if (!int64_check(L, 1, &a) || !int64_check(L, 2, &b)) {
         // Arguments are not numbers
         printf("[b_xor] Both arguments must be integers");
         return 0;
     }
 
-    lua_Integer a = lua_tointeger(L, 1);
-    lua_Integer b = lua_tointeger(L, 2);
+    uint64_t result = a.bits ^ b.bits;
 
-    lua_Integer result = a ^ b;
-
-    lua_pushinteger(L, result);
+    push_result(L, result);
     return 1;
 }
 
@@ -99,17 +123,16 @@ int b_not(lua_State* L)
         return 0;
     }
 
-    if (!lua_isnumber(L, 1)) {
+    LasrInt64 a;
+    if (!int64_check(L, 1, &a)) {
         // Argument is not number
         printf("[b_not] The argument must be an integer");
         return 0;
     }
 
-    lua_Integer a = lua_tointeger(L, 1);
-
-    lua_Integer result = ~a;
+    uint64_t result = ~a.bits;
 
-    lua_pushinteger(L, result);
+    push_result(L, result);
     return 1;
 }
 
@@ -126,18 +149,16 @@ int b_lshift(lua_State* L)
         return 0;
     }
 
-    if (!lua_isnumber(L, 1) || !lua_isnumber(L, 2)) {
+    LasrInt64 a, b;
+    if (!int64_check(L, 1, &a) || !int64_check(L, 2, &b)) {
         // Arguments are not numbers
         printf("[b_lshift] Both arguments must be integers");
         return 0;
     }
 
-    lua_Integer a = lua_tointeger(L, 1);
-    lua_Integer b = lua_tointeger(L, 2);
+    uint64_t result = b.bits < 64 ? a.bits << b.bits : 0;
 
-    lua_Integer result = a << b;
-
-    lua_pushinteger(L, result);
+    push_result(L, result);
     return 1;
 }
 
@@ -154,17 +175,17 @@ int b_rshift(lua_State* L)
         return 0;
     }
 
-    if (!lua_isnumber(L, 1) || !lua_isnumber(L, 2)) {
+    LasrInt64 a, b;
+    if (!int64_check(L, 1, &a) || !int64_check(L, 2, &b)) {
         // Arguments are not numbers
         printf("[b_rshift] Both arguments must be integers");
         return 0;
     }
 
-    lua_Integer a = lua_tointeger(L, 1);
-    lua_Integer b = lua_tointeger(L, 2);
-
-    lua_Integer result = a >> b;
+    // Unsigned integers are shifted logically, signed ones keep their sign
+    uint64_t shift = b.bits < 64 ? b.bits : 63;
+    uint64_t result = a.is_unsigned ? (b.bits < 64 ? a.bits >> shift : 0) : (uint64_t)((int64_t)a.bits >> shift);
 
-    lua_pushinteger(L, result);
+    push_result(L, result);
     return 1;
 }
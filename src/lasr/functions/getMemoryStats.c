@@ -0,0 +1,37 @@
+#include "getMemoryStats.h"
+
+#include "../alloc/alloc.h"
+
+#include <stdio.h>
+
+/**
+ * Returns the allocation counters of the auto splitter Lua state as a table.
+ *
+ * @param L The lua stack
+ *
+ * @return Always 1.
+ */
+int getMemoryStats(lua_State* L)
+{
+    if (lua_gettop(L) != 0) {
+        printf("[getMemoryStats] No arguments accepted");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_createtable(L, 0, 6);
+    lua_pushnumber(L, lasr_alloc_stats.in_use);
+    lua_setfield(L, -2, "inUse");
+    lua_pushnumber(L, lasr_alloc_stats.peak);
+    lua_setfield(L, -2, "peak");
+    lua_pushnumber(L, lasr_alloc_stats.pooled);
+    lua_setfield(L, -2, "pooled");
+    lua_pushnumber(L, lasr_alloc_stats.allocations);
+    lua_setfield(L, -2, "allocations");
+    lua_pushnumber(L, lasr_alloc_stats.frees);
+    lua_setfield(L, -2, "frees");
+    // Counted by the collector itself, also valid when the default allocator is in use
+    lua_pushnumber(L, lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0));
+    lua_setfield(L, -2, "gcCount");
+    return 1;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <lua.h>
+
+int getMemoryStats(lua_State* L);
@@ -1,14 +1,18 @@
 #include "process.h"
 
+#include "../auto-splitter.h"
+#include "../memory.h"
+#include "../replay/replay.h"
 #include "../utils.h"
 
+#include <lauxlib.h>
 #include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-extern atomic_bool auto_splitter_enabled; /*!< Defines if the auto splitter is enabled */
+static char process_name[PATH_MAX]; /*!< Owned copy of the process name, outlives the Lua string */
 
 /**
  * Executes a command, piping its output into an output string.
@@ -37,7 +41,15 @@ void stock_process_id(const char* pid_command)
     char pid_output[PATH_MAX + 100];
     pid_output[0] = '\0';
 
-    while (atomic_load(&auto_splitter_enabled)) {
+    // The recording knows which process was attached, the game doesn't need to run. This
+    // runs on every start, only a hot reload keeps the process without coming here
+    if (replay_mode == REPLAY_REPLAYING) {
+        if (!replay_read_pid(&process.pid)) {
+            process.pid = 0;
+        }
+    }
+
+    while (replay_mode != REPLAY_REPLAYING && atomic_load(&auto_splitter_enabled)) {
         execute_command(pid_command, pid_output);
         process.pid = strtoul(pid_output, NULL, 10);
         if (process.pid) {
@@ -54,8 +66,14 @@ void stock_process_id(const char* pid_command)
 
     printf("Process: %s\n", process.name);
     printf("PID: %u\n", process.pid);
+    if (replay_mode == REPLAY_RECORDING) {
+        replay_record_pid(process.pid);
+    }
     process.base_address = find_base_address(NULL);
     process.dll_address = process.base_address;
+    if (process.pid) {
+        memory_attach(process.pid, process.base_address);
+    }
 }
 
 /**
@@ -67,9 +85,19 @@ void stock_process_id(const char* pid_command)
  */
 int find_process_id(lua_State* L)
 {
+    const char* name = luaL_checkstring(L, 1);
+
+    // A hot reloaded script asks for the process it is already attached to. A fresh run
+    // always attaches again, for the memory backend and the recording
+    if (auto_splitter_reloading && process.pid != 0 && process.name && strcmp(process.name, name) == 0 && process_exists()) {
+        return 0;
+    }
+
     printf("\033[2J\033[1;1H"); // Clear the console
 
-    process.name = lua_tostring(L, 1);
+    strncpy(process_name, name, sizeof(process_name) - 1);
+    process_name[sizeof(process_name) - 1] = '\0';
+    process.name = process_name;
     const char* sort = lua_tostring(L, 2);
     char sortCmd[16] = "";
 
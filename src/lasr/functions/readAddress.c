@@ -1,8 +1,12 @@
 #include "readAddress.h"
 
+#include "../int64/int64.h"
+#include "../memory.h"
+#include "../types.h"
 #include "../utils.h"
 
 #include <errno.h>
+#include <lauxlib.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -22,19 +26,11 @@ bool memory_error = false;
     {                                                                                            \
         value_type value = 0;                                                                    \
                                                                                                  \
-        struct iovec mem_local;                                                                  \
-        struct iovec mem_remote;                                                                 \
-                                                                                                 \
-        mem_local.iov_base = &value;                                                             \
-        mem_local.iov_len = sizeof(value);                                                       \
-        mem_remote.iov_len = sizeof(value);                                                      \
-        mem_remote.iov_base = (void*)(uintptr_t)mem_address;                                     \
-                                                                                                 \
-        ssize_t mem_n_read = process_vm_readv(process.pid, &mem_local, 1, &mem_remote, 1, 0);    \
+        ssize_t mem_n_read = read_process_memory(mem_address, &value, sizeof(value));            \
         if (mem_n_read == -1) {                                                                  \
             *err = (int32_t)errno;                                                               \
             memory_error = true;                                                                 \
-        } else if (mem_n_read != (ssize_t)mem_remote.iov_len) {                                  \
+        } else if (mem_n_read != (ssize_t)sizeof(value)) {                                       \
             printf("Error reading process memory: short read of %ld bytes\n", (long)mem_n_read); \
         }                                                                                        \
                                                                                                  \
@@ -54,54 +50,352 @@ READ_MEMORY_FUNCTION(double)
 READ_MEMORY_FUNCTION(bool)
 
 /**
- * Reads an address from memory and interprets it as a string.
+ * Scratch memory for string reads, grown as needed and reused by every read.
+ */
+static uint8_t* string_scratch = NULL;
+static size_t string_scratch_size = 0;
+
+/**
+ * Gets the string scratch buffer, growing it if needed.
+ *
+ * @param size The minimum size of the buffer.
+ *
+ * @return The scratch buffer, or NULL if it couldn't be grown.
+ */
+static uint8_t* get_string_scratch(size_t size)
+{
+    if (size > string_scratch_size) {
+        uint8_t* buffer = realloc(string_scratch, size);
+        if (!buffer) {
+            return NULL;
+        }
+        string_scratch = buffer;
+        string_scratch_size = size;
+    }
+    return string_scratch;
+}
+
+/**
+ * Reads a block of memory into the string scratch buffer.
+ *
+ * A short read is not an error: strings often end right before an unmapped page,
+ * so whatever could be read is used.
  *
  * @param mem_address The memory address to read from.
- * @param buffer_size The size of the buffer to allocate.
- * @param err A pointer to an error flag to write to.
+ * @param size The number of bytes to read.
+ * @param[out] n_read The number of bytes actually read.
+ * @param[out] err The error code, if the read failed.
  *
- * @return The string read from memory.
+ * @return The scratch buffer, with room for `size` bytes, or NULL on error.
  */
-char* read_memory_string(uint64_t mem_address, int buffer_size, int32_t* err)
+static uint8_t* read_string_bytes(uint64_t mem_address, size_t size, size_t* n_read, int32_t* err)
 {
-    char* buffer = (char*)malloc(buffer_size);
-    if (buffer == NULL) {
-        // Handle memory allocation failure
+    // Leave room for the converted text of UTF-16 strings after the raw bytes
+    uint8_t* buffer = get_string_scratch(size * 3);
+    if (!buffer) {
+        printf("[readAddress] Memory allocation failed for string.\n");
+        memory_error = true;
+        return NULL;
+    }
+
+    ssize_t mem_n_read = read_process_memory(mem_address, buffer, size);
+    if (mem_n_read == -1) {
+        *err = (int32_t)errno;
+        memory_error = true;
         return NULL;
     }
+    *n_read = mem_n_read;
+    return buffer;
+}
+
+/**
+ * Converts UTF-16LE text to UTF-8, stopping at the first NUL character.
+ *
+ * @param src The UTF-16LE text.
+ * @param units The maximum number of UTF-16 code units to convert.
+ * @param dst The output buffer, at least `units * 3` bytes long.
+ *
+ * @return The length of the UTF-8 text.
+ */
+static size_t utf16le_to_utf8(const uint8_t* src, size_t units, char* dst)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < units; i++) {
+        uint32_t c = src[i * 2] | (src[i * 2 + 1] << 8);
+        if (c == 0) {
+            break;
+        }
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < units) {
+            uint32_t low = src[i * 2 + 2] | (src[i * 2 + 3] << 8);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+        if (c >= 0xD800 && c <= 0xDFFF) {
+            c = 0xFFFD; // Unpaired surrogate
+        }
+
+        if (c < 0x80) {
+            dst[length++] = c;
+        } else if (c < 0x800) {
+            dst[length++] = 0xC0 | (c >> 6);
+            dst[length++] = 0x80 | (c & 0x3F);
+        } else if (c < 0x10000) {
+            dst[length++] = 0xE0 | (c >> 12);
+            dst[length++] = 0x80 | ((c >> 6) & 0x3F);
+            dst[length++] = 0x80 | (c & 0x3F);
+        } else {
+            // Took two code units, so there's room for 4 bytes
+            dst[length++] = 0xF0 | (c >> 18);
+            dst[length++] = 0x80 | ((c >> 12) & 0x3F);
+            dst[length++] = 0x80 | ((c >> 6) & 0x3F);
+            dst[length++] = 0x80 | (c & 0x3F);
+        }
+    }
+    return length;
+}
+
+/**
+ * Reads a string from memory and pushes it onto the Lua stack.
+ *
+ * Supported encodings are:
+ * - `stringN`: NUL-terminated 8 bit text, up to N bytes including the terminator.
+ * - `wstringN`: NUL-terminated UTF-16LE text, up to N characters including the terminator.
+ * - `lstringN`: 8 bit text of up to N bytes, preceded by its length as a 32 bit integer.
+ * - `lwstringN`: UTF-16LE text of up to N characters, preceded by its length in characters
+ *   as a 32 bit integer, like .NET strings.
+ *
+ * Nothing is pushed if the read failed.
+ *
+ * @param L The Lua state.
+ * @param mem_address The memory address to read from.
+ * @param type The string type.
+ * @param err A pointer to an error flag to write to.
+ */
+static void push_memory_string(lua_State* L, uint64_t mem_address, LasrTypeHandle type, int32_t* err)
+{
+    bool wide = type.type == LASR_TYPE_WSTRING || type.type == LASR_TYPE_LWSTRING;
+    bool prefixed = type.type == LASR_TYPE_LSTRING || type.type == LASR_TYPE_LWSTRING;
+    size_t prefix = lasr_types[type.type].prefix;
+    size_t unit = lasr_types[type.type].size;
+    size_t size = lasr_type_size(type);
+
+    size_t n_read;
+    uint8_t* buffer = read_string_bytes(mem_address, size, &n_read, err);
+    if (!buffer) {
+        return;
+    }
+    if (n_read < prefix) {
+        printf("Error reading process memory: short read of %zu bytes\n", n_read);
+        memory_error = true;
+        return;
+    }
+
+    size_t units = (n_read - prefix) / unit;
+    if (prefixed) {
+        int32_t length;
+        memcpy(&length, buffer, sizeof(length));
+        if (length < 0) {
+            length = 0;
+        }
+        if ((size_t)length < units) {
+            units = length;
+        }
+    }
+
+    const uint8_t* text = buffer + prefix;
+    if (wide) {
+        char* utf8 = (char*)buffer + size;
+        size_t length = utf16le_to_utf8(text, units, utf8);
+        lua_pushlstring(L, utf8, length);
+    } else if (prefixed) {
+        lua_pushlstring(L, (const char*)text, units);
+    } else {
+        lua_pushlstring(L, (const char*)text, strnlen((const char*)text, units));
+    }
+}
+
+/**
+ * Resolves the address described by readAddress-like arguments.
+ *
+ * Starting from `index`, the arguments are either an offset from the main module, a module
+ * name followed by an offset or an absolute address as a boxed 64 bit integer, then the
+ * offsets of the pointer chain to follow.
+ *
+ * @param L The Lua state.
+ * @param index The stack index of the first address argument.
+ * @param[out] address The resolved address.
+ * @param[out] err The error code of the failed read, if any.
+ *
+ * @return False if a pointer in the chain couldn't be read.
+ */
+bool resolve_address(lua_State* L, int index, uint64_t* address, int32_t* err)
+{
+    int i;
+    LasrInt64 pointer;
+
+    if (int64_is_boxed(L, index)) {
+        // A pointer read as a 64 bit integer, used as an absolute address
+        int64_check(L, index, &pointer);
+        *address = pointer.bits;
+        i = index + 1;
+    } else if (lua_isnumber(L, index)) {
+        *address = process.base_address + lua_tointeger(L, index);
+        i = index + 1;
+    } else {
+        const char* module = lua_tostring(L, index);
+        if (strcmp(process.name, module) != 0) {
+            process.dll_address = find_base_address(module);
+        }
+        *address = process.dll_address + lua_tointeger(L, index + 1);
+        i = index + 2;
+    }
 
-    struct iovec mem_local;
-    struct iovec mem_remote;
+    for (; i <= lua_gettop(L); i++) {
+        if (*address <= UINT32_MAX) {
+            *address = read_memory_uint32_t(*address, err);
+        } else {
+            *address = read_memory_uint64_t(*address, err);
+        }
+        if (memory_error)
+            return false;
+        *address += lua_tointeger(L, i);
+    }
+    return true;
+}
 
-    mem_local.iov_base = buffer;
-    mem_local.iov_len = buffer_size;
-    mem_remote.iov_len = buffer_size;
-    mem_remote.iov_base = (void*)(uintptr_t)mem_address;
+/**
+ * Reads an array of bytes from memory and pushes it onto the Lua stack as a table.
+ *
+ * Nothing is pushed if the read failed.
+ *
+ * @param L The Lua state.
+ * @param mem_address The memory address to read from.
+ * @param type The byte array type.
+ * @param err A pointer to an error flag to write to.
+ */
+static void push_memory_byte_array(lua_State* L, uint64_t mem_address, LasrTypeHandle type, int32_t* err)
+{
+    uint32_t array_size = type.count;
+    uint8_t* results = malloc(array_size * sizeof(uint8_t));
+    if (!results) {
+        printf("[readAddress] Memory allocation failed for byte array.\n");
+        exit(1);
+    }
 
-    ssize_t mem_n_read = process_vm_readv(process.pid, &mem_local, 1, &mem_remote, 1, 0);
+    // Read the whole array at once, a partial read is treated as a failure
+    // so we don't push partial data to Lua
+    ssize_t mem_n_read = read_process_memory(mem_address, results, array_size);
     if (mem_n_read == -1) {
-        buffer[0] = '\0';
         *err = (int32_t)errno;
         memory_error = true;
-    } else if (mem_n_read != (ssize_t)mem_remote.iov_len) {
+    } else if (mem_n_read != (ssize_t)array_size) {
         printf("Error reading process memory: short read of %ld bytes\n", (long)mem_n_read);
-        exit(1);
+        memory_error = true;
     }
 
-    return buffer;
+    if (!memory_error) {
+        lua_createtable(L, array_size, 0);
+        for (uint32_t j = 0; j < array_size; j++) {
+            lua_pushinteger(L, results[j]);
+            lua_rawseti(L, -2, j + 1);
+        }
+    }
+    free(results);
+}
+
+/**
+ * Reads a value of a fixed size type and pushes it onto the Lua stack, creating the relative
+ * push_memory_<value_type> function
+ *
+ * @param value_type The type to read, with a read_memory_<value_type> function
+ * @param push The Lua function pushing the value
+ */
+#define PUSH_MEMORY_FUNCTION(value_type, push)                                                            \
+    static void push_memory_##value_type(lua_State* L, uint64_t mem_address, LasrTypeHandle type, int32_t* err) \
+    {                                                                                                     \
+        (void)type;                                                                                       \
+        push(L, read_memory_##value_type(mem_address, err));                                              \
+    }
+
+PUSH_MEMORY_FUNCTION(int8_t, lua_pushinteger)
+PUSH_MEMORY_FUNCTION(uint8_t, lua_pushinteger)
+PUSH_MEMORY_FUNCTION(int16_t, lua_pushinteger)
+PUSH_MEMORY_FUNCTION(uint16_t, lua_pushinteger)
+PUSH_MEMORY_FUNCTION(int32_t, lua_pushinteger)
+PUSH_MEMORY_FUNCTION(uint32_t, lua_pushinteger)
+PUSH_MEMORY_FUNCTION(float, lua_pushnumber)
+PUSH_MEMORY_FUNCTION(double, lua_pushnumber)
+PUSH_MEMORY_FUNCTION(bool, lua_pushboolean)
+
+/**
+ * Reads a 64 bit integer and pushes it onto the Lua stack, as a plain number when it fits
+ * in a double without losing precision for long and ulong, always boxed for int64 and uint64.
+ *
+ * @param L The Lua state.
+ * @param mem_address The memory address to read from.
+ * @param type The integer type.
+ * @param err A pointer to an error flag to write to.
+ */
+static void push_memory_int64(lua_State* L, uint64_t mem_address, LasrTypeHandle type, int32_t* err)
+{
+    uint64_t value = read_memory_uint64_t(mem_address, err);
+    bool is_unsigned = type.type == LASR_TYPE_ULONG || type.type == LASR_TYPE_UINT64;
+    if (type.type == LASR_TYPE_LONG || type.type == LASR_TYPE_ULONG) {
+        int64_push_exact(L, value, is_unsigned);
+    } else {
+        int64_push(L, value, is_unsigned);
+    }
 }
 
+/**
+ * Reads a value from memory and pushes it onto the Lua stack.
+ */
+typedef void (*read_handler)(lua_State* L, uint64_t mem_address, LasrTypeHandle type, int32_t* err);
+
+/**
+ * The reading function of each type.
+ */
+static const read_handler read_handlers[LASR_TYPE_COUNT] = {
+    [LASR_TYPE_SBYTE] = push_memory_int8_t,
+    [LASR_TYPE_BYTE] = push_memory_uint8_t,
+    [LASR_TYPE_SHORT] = push_memory_int16_t,
+    [LASR_TYPE_USHORT] = push_memory_uint16_t,
+    [LASR_TYPE_INT] = push_memory_int32_t,
+    [LASR_TYPE_UINT] = push_memory_uint32_t,
+    [LASR_TYPE_LONG] = push_memory_int64,
+    [LASR_TYPE_ULONG] = push_memory_int64,
+    [LASR_TYPE_INT64] = push_memory_int64,
+    [LASR_TYPE_UINT64] = push_memory_int64,
+    [LASR_TYPE_FLOAT] = push_memory_float,
+    [LASR_TYPE_DOUBLE] = push_memory_double,
+    [LASR_TYPE_BOOL] = push_memory_bool,
+    [LASR_TYPE_STRING] = push_memory_string,
+    [LASR_TYPE_WSTRING] = push_memory_string,
+    [LASR_TYPE_LSTRING] = push_memory_string,
+    [LASR_TYPE_LWSTRING] = push_memory_string,
+    [LASR_TYPE_BYTE_ARRAY] = push_memory_byte_array,
+};
+
 /**
  * Reads a memory address given by the Lua Auto Splitter.
  *
+ * The type can be given either as a name or as a handle from the T table.
+ *
  * @param L The Lua state.
  */
 int readAddress(lua_State* L)
 {
     memory_error = false;
     uint64_t address;
-    const char* value_type = lua_tostring(L, 1);
-    int i;
+    LasrTypeHandle value_type;
+
+    if (!lasr_check_type(L, 1, &value_type)) {
+        printf("[readAddress] Invalid value type: %s\n", lua_isstring(L, 1) ? lua_tostring(L, 1) : luaL_typename(L, 1));
+        lua_pushnil(L);
+        return 1;
+    }
 
     if (lua_isnil(L, 2)) {
         // The address is NULL, this will bring a segfault if left alone
@@ -110,110 +404,10 @@ int readAddress(lua_State* L)
         return 1;
     }
 
-    if (lua_isnumber(L, 2)) {
-        address = process.base_address + lua_tointeger(L, 2);
-        i = 3;
-    } else {
-        const char* module = lua_tostring(L, 2);
-        if (strcmp(process.name, module) != 0) {
-            process.dll_address = find_base_address(module);
-        }
-        address = process.dll_address + lua_tointeger(L, 3);
-        i = 4;
-    }
-
     int error = 0;
 
-    for (; i <= lua_gettop(L); i++) {
-        if (address <= UINT32_MAX) {
-            address = read_memory_uint32_t((uint64_t)address, &error);
-            if (memory_error)
-                break;
-        } else {
-            address = read_memory_uint64_t(address, &error);
-            if (memory_error)
-                break;
-        }
-        address += lua_tointeger(L, i);
-    }
-
-    if (strcmp(value_type, "sbyte") == 0) {
-        int8_t value = read_memory_int8_t(address, &error);
-        lua_pushinteger(L, value);
-    } else if (strcmp(value_type, "byte") == 0) {
-        uint8_t value = read_memory_uint8_t(address, &error);
-        lua_pushinteger(L, value);
-    } else if (strcmp(value_type, "short") == 0) {
-        int16_t value = read_memory_int16_t(address, &error);
-        lua_pushinteger(L, value);
-    } else if (strcmp(value_type, "ushort") == 0) {
-        uint16_t value = read_memory_uint16_t(address, &error);
-        lua_pushinteger(L, value);
-    } else if (strcmp(value_type, "int") == 0) {
-        int32_t value = read_memory_int32_t(address, &error);
-        lua_pushinteger(L, value);
-    } else if (strcmp(value_type, "uint") == 0) {
-        uint32_t value = read_memory_uint32_t(address, &error);
-        lua_pushinteger(L, value);
-    } else if (strcmp(value_type, "long") == 0) {
-        // TODO: Fix 64 bit numbers, luajit 5.1 doesnt support 64 bit numbers natively
-        int64_t value = read_memory_int64_t(address, &error);
-        lua_pushinteger(L, value);
-    } else if (strcmp(value_type, "ulong") == 0) {
-        // TODO: Fix 64 bit numbers, luajit 5.1 doesnt support 64 bit numbers natively
-        uint64_t value = read_memory_uint64_t(address, &error);
-        lua_pushinteger(L, value);
-    } else if (strcmp(value_type, "float") == 0) {
-        float value = read_memory_float(address, &error);
-        lua_pushnumber(L, value);
-    } else if (strcmp(value_type, "double") == 0) {
-        double value = read_memory_double(address, &error);
-        lua_pushnumber(L, value);
-    } else if (strcmp(value_type, "bool") == 0) {
-        bool value = read_memory_bool(address, &error);
-        lua_pushboolean(L, value ? 1 : 0);
-    } else if (strstr(value_type, "string") != NULL) {
-        int buffer_size = atoi(value_type + 6);
-        if (buffer_size < 2) {
-            printf("[readAddress] Invalid string size, please read documentation");
-            exit(1);
-        }
-        char* value = read_memory_string(address, buffer_size, &error);
-        lua_pushstring(L, value != NULL ? value : "");
-        free(value);
-    } else if (strstr(value_type, "byte")) {
-        int array_size = atoi(value_type + 4);
-        if (array_size < 1) {
-            printf("[readAddress] Invalid byte array size, please read documentation");
-            exit(1);
-        }
-        uint8_t* results = malloc(array_size * sizeof(uint8_t));
-        if (!results) {
-            printf("[readAddress] Memory allocation failed for byte array.\n");
-            exit(1);
-        }
-        for (int j = 0; j < array_size; j++) {
-            uint8_t value = read_memory_uint8_t(address + j, &error);
-            if (memory_error)
-                break;
-            results[j] = value;
-        }
-
-        // Now that we have the results, push them to Lua table
-        // This is because if the read_memory fails midway, we don't want to push partial data
-        // And also want to avoid pushing the fallback result as part of the table
-        if (!memory_error) {
-            lua_createtable(L, array_size, 0);
-            for (int j = 0; j < array_size; j++) {
-                uint8_t value = results[j];
-                lua_pushinteger(L, value);
-                lua_rawseti(L, -2, j + 1);
-            }
-        }
-        free(results);
-    } else {
-        printf("[readAddress] Invalid value type: %s\n", value_type);
-        exit(1);
+    if (resolve_address(L, 2, &address, &error)) {
+        read_handlers[value_type.type](L, address, value_type, &error);
     }
 
     if (memory_error) {
@@ -1,5 +1,10 @@
 #pragma once
 
 #include <lua.h>
+#include <stdbool.h>
+#include <stdint.h>
 
-int readAddress(lua_State* L);
\ No newline at end of file
+extern bool memory_error;
+
+bool resolve_address(lua_State* L, int index, uint64_t* address, int32_t* err);
+int readAddress(lua_State* L);
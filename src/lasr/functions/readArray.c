@@ -0,0 +1,154 @@
+#include "readArray.h"
+
+#include "../memory.h"
+#include "../types.h"
+#include "../utils.h"
+#include "readAddress.h"
+
+#include <errno.h>
+#include <lauxlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ARRAY_METATABLE "LASR.Array"
+#define ARRAY_MAX_SIZE (16 * 1024 * 1024)
+
+/**
+ * An array read from the game memory, followed in memory by its raw bytes.
+ */
+typedef struct ArrayData {
+    LasrType type; /*!< The type of the elements */
+    uint32_t element_size; /*!< The size of each element */
+    uint32_t count; /*!< The number of elements */
+    bool valid; /*!< False if the last read failed */
+    uint8_t data[]; /*!< The bytes of the elements, as read from memory */
+} ArrayData;
+
+/**
+ * The __index metamethod of arrays, decoding the requested element.
+ *
+ * @param L The Lua state.
+ *
+ * @return Always 1, the element or nil if the index is out of range.
+ */
+static int array_index(lua_State* L)
+{
+    ArrayData* array = luaL_checkudata(L, 1, ARRAY_METATABLE);
+    lua_Integer index = lua_isnumber(L, 2) ? lua_tointeger(L, 2) : 0;
+    if (!array->valid || index < 1 || index > array->count) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lasr_push_value(L, array->type, array->data + (index - 1) * array->element_size);
+    return 1;
+}
+
+/**
+ * The __len metamethod of arrays.
+ *
+ * @param L The Lua state.
+ *
+ * @return Always 1, the number of elements.
+ */
+static int array_len(lua_State* L)
+{
+    ArrayData* array = luaL_checkudata(L, 1, ARRAY_METATABLE);
+    lua_pushinteger(L, array->count);
+    return 1;
+}
+
+/**
+ * The "readArray" Lua Auto Splitter Runtime function.
+ *
+ * Reads `count` contiguous elements of a type with a single memory read. Takes either
+ * a type, as a name or a handle from the T table, and a count, or an array returned by a previous call to read into it again,
+ * followed by the same address arguments as readAddress.
+ *
+ * @param L The Lua state.
+ *
+ * @return Always 1, the array or nil on error.
+ */
+int readArray(lua_State* L)
+{
+    ArrayData* array = NULL;
+    LasrType type;
+    uint32_t element_size;
+    lua_Integer count;
+    int address_index;
+
+    if (lua_isuserdata(L, 1)) {
+        // Reuse the buffer of a previous read
+        array = luaL_checkudata(L, 1, ARRAY_METATABLE);
+        array->valid = false;
+        type = array->type;
+        element_size = array->element_size;
+        count = array->count;
+        address_index = 2;
+    } else {
+        LasrTypeHandle handle;
+        count = lua_tointeger(L, 2);
+        if (!lasr_check_type(L, 1, &handle) || !lasr_type_is_scalar(handle.type)) {
+            printf("[readArray] Invalid element type: %s\n", lua_isstring(L, 1) ? lua_tostring(L, 1) : luaL_typename(L, 1));
+            lua_pushnil(L);
+            return 1;
+        }
+        type = handle.type;
+        element_size = lasr_type_size(handle);
+        if (count < 1 || count > ARRAY_MAX_SIZE / element_size) {
+            printf("[readArray] Invalid element count: %ld\n", (long)count);
+            lua_pushnil(L);
+            return 1;
+        }
+        address_index = 3;
+    }
+
+    if (lua_isnil(L, address_index)) {
+        printf("[readArray] The address argument cannot be nil. Check your auto splitter code.\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    memory_error = false;
+    int32_t error = 0;
+    uint64_t address;
+    if (!resolve_address(L, address_index, &address, &error)) {
+        handle_memory_error(error);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    if (array) {
+        lua_pushvalue(L, 1);
+    } else {
+        array = lua_newuserdata(L, sizeof(ArrayData) + count * element_size);
+        array->type = type;
+        array->element_size = element_size;
+        array->count = count;
+        if (luaL_newmetatable(L, ARRAY_METATABLE)) {
+            lua_pushcfunction(L, array_index);
+            lua_setfield(L, -2, "__index");
+            lua_pushcfunction(L, array_len);
+            lua_setfield(L, -2, "__len");
+        }
+        lua_setmetatable(L, -2);
+    }
+
+    // One read for the whole array, whatever its length
+    lua_Integer size = count * element_size;
+    ssize_t n_read = read_process_memory(address, array->data, size);
+    if (n_read != size) {
+        if (n_read == -1) {
+            handle_memory_error(errno);
+        } else {
+            printf("[readArray] Short read of %ld bytes out of %ld\n", (long)n_read, (long)size);
+        }
+        array->valid = false;
+        lua_pop(L, 1);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    array->valid = true;
+    return 1;
+}
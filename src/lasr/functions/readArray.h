@@ -0,0 +1,5 @@
+#pragma once
+
+#include <lua.h>
+
+int readArray(lua_State* L);
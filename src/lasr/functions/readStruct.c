@@ -0,0 +1,204 @@
+#include "readStruct.h"
+
+#include "../memory.h"
+#include "../types.h"
+#include "../utils.h"
+#include "readAddress.h"
+
+#include <errno.h>
+#include <lauxlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STRUCT_METATABLE "LASR.Struct"
+#define STRUCT_FIELD_NAME_SIZE 64
+#define STRUCT_MAX_SPAN (1024 * 1024)
+
+/**
+ * A field of a struct layout.
+ */
+typedef struct StructField {
+    char name[STRUCT_FIELD_NAME_SIZE]; /*!< The key of the field in the result table */
+    LasrType type; /*!< How to decode the field */
+    uint32_t offset; /*!< Offset of the field from the start of the read span */
+    uint32_t size; /*!< Size of the field in bytes */
+} StructField;
+
+/**
+ * A struct layout, followed in memory by its fields and the buffer for the read span.
+ */
+typedef struct StructLayout {
+    int field_count; /*!< Number of fields */
+    uint32_t first_offset; /*!< Lowest field offset, where the read starts */
+    uint32_t span; /*!< Number of bytes covered by the fields */
+    StructField fields[]; /*!< The fields, followed by `span` bytes of read buffer */
+} StructLayout;
+
+/**
+ * Pushes the value of a struct field, decoded from the memory read from the game.
+ *
+ * @param L The Lua state.
+ * @param field The field.
+ * @param data The bytes of the field.
+ */
+static void push_field_value(lua_State* L, const StructField* field, const uint8_t* data)
+{
+    if (field->type == LASR_TYPE_STRING) {
+        lua_pushlstring(L, (const char*)data, strnlen((const char*)data, field->size));
+    } else {
+        lasr_push_value(L, field->type, data);
+    }
+}
+
+/**
+ * The "defineStruct" Lua Auto Splitter Runtime function.
+ *
+ * Takes an array of `{ name, type, offset }` field definitions and returns a struct
+ * layout to be used with readStruct. Fields can be of any fixed size type or `stringN`.
+ *
+ * @param L The Lua state.
+ *
+ * @return Always 1, the struct layout or nil if the definition is invalid.
+ */
+int defineStruct(lua_State* L)
+{
+    if (!lua_istable(L, 1)) {
+        printf("[defineStruct] The argument must be a table of { name, type, offset } fields\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    int field_count = lua_objlen(L, 1);
+    if (field_count < 1) {
+        printf("[defineStruct] A struct needs at least one field\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    StructField* fields = malloc(field_count * sizeof(StructField));
+    if (!fields) {
+        printf("[defineStruct] Memory allocation failed\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    uint32_t first_offset = UINT32_MAX;
+    uint32_t end_offset = 0;
+    for (int i = 0; i < field_count; i++) {
+        lua_rawgeti(L, 1, i + 1);
+        lua_rawgeti(L, -1, 1);
+        lua_rawgeti(L, -2, 2);
+        lua_rawgeti(L, -3, 3);
+        // Stack: definition, field, name, type, offset
+
+        const char* name = lua_isstring(L, -3) ? lua_tostring(L, -3) : NULL;
+        lua_Integer offset = lua_tointeger(L, -1);
+        StructField* field = &fields[i];
+        if (!name || lua_isnil(L, -2) || !lua_isnumber(L, -1) || offset < 0 || offset > STRUCT_MAX_SPAN) {
+            printf("[defineStruct] Field %d must be { name, type, offset }\n", i + 1);
+            lua_pop(L, 4);
+            free(fields);
+            lua_pushnil(L);
+            return 1;
+        }
+        LasrTypeHandle type;
+        bool valid_type = lasr_check_type(L, -2, &type)
+            && (lasr_type_is_scalar(type.type) || type.type == LASR_TYPE_STRING);
+        if (strlen(name) >= sizeof(field->name) || !valid_type) {
+            printf("[defineStruct] Invalid field '%s' of type '%s'\n", name, lua_tostring(L, -2));
+            lua_pop(L, 4);
+            free(fields);
+            lua_pushnil(L);
+            return 1;
+        }
+        strcpy(field->name, name);
+        field->type = type.type;
+        field->size = lasr_type_size(type);
+        field->offset = offset;
+        lua_pop(L, 4);
+
+        if (field->offset < first_offset) {
+            first_offset = field->offset;
+        }
+        if (field->offset + field->size > end_offset) {
+            end_offset = field->offset + field->size;
+        }
+    }
+
+    uint32_t span = end_offset - first_offset;
+    if (span > STRUCT_MAX_SPAN) {
+        printf("[defineStruct] The struct is too big, fields can span up to %d bytes\n", STRUCT_MAX_SPAN);
+        free(fields);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    StructLayout* layout = lua_newuserdata(L, sizeof(StructLayout) + field_count * sizeof(StructField) + span);
+    layout->field_count = field_count;
+    layout->first_offset = first_offset;
+    layout->span = span;
+    memcpy(layout->fields, fields, field_count * sizeof(StructField));
+    free(fields);
+
+    luaL_newmetatable(L, STRUCT_METATABLE); // Pushes the existing metatable after the first struct
+    lua_setmetatable(L, -2);
+
+    // The result table is kept in the layout's environment and reused by every read
+    lua_createtable(L, 0, field_count);
+    lua_setfenv(L, -2);
+    return 1;
+}
+
+/**
+ * The "readStruct" Lua Auto Splitter Runtime function.
+ *
+ * Takes a struct layout followed by the same address arguments as readAddress. The pointer
+ * chain is resolved once and the whole struct is read with a single memory read.
+ *
+ * The same table is returned and updated by every read of the same layout.
+ *
+ * @param L The Lua state.
+ *
+ * @return Always 1, the table of field values or nil on error.
+ */
+int readStruct(lua_State* L)
+{
+    StructLayout* layout = luaL_checkudata(L, 1, STRUCT_METATABLE);
+
+    if (lua_isnil(L, 2)) {
+        printf("[readStruct] The address argument cannot be nil. Check your auto splitter code.\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    memory_error = false;
+    int32_t error = 0;
+    uint64_t address;
+    if (!resolve_address(L, 2, &address, &error)) {
+        handle_memory_error(error);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    uint8_t* buffer = (uint8_t*)&layout->fields[layout->field_count];
+    ssize_t n_read = read_process_memory(address + layout->first_offset, buffer, layout->span);
+    if (n_read != (ssize_t)layout->span) {
+        if (n_read == -1) {
+            handle_memory_error(errno);
+        } else {
+            printf("[readStruct] Short read of %ld bytes out of %u\n", (long)n_read, layout->span);
+        }
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_getfenv(L, 1);
+    for (int i = 0; i < layout->field_count; i++) {
+        const StructField* field = &layout->fields[i];
+        push_field_value(L, field, buffer + field->offset - layout->first_offset);
+        lua_setfield(L, -2, field->name);
+    }
+    return 1;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <lua.h>
+
+int defineStruct(lua_State* L);
+int readStruct(lua_State* L);
@@ -1,16 +1,27 @@
 #include "signature.h"
 
+#include "../auto-splitter.h"
+#include "../memory.h"
+#include "../profiler/profiler.h"
+#include "../replay/replay.h"
 #include "../utils.h"
 
 #include <fcntl.h>
 #include <inttypes.h>
+#include <lauxlib.h>
 #include <lua.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#define SIGNATURE_METATABLE "LASR.Signature"
+
 // Error handling macro
 #define HANDLE_ERROR(msg) \
     do {                  \
@@ -18,6 +29,104 @@
         return NULL;      \
     } while (0)
 
+/**
+ * A successful signature scan, kept so that hot reloaded scripts don't scan again.
+ */
+typedef struct sig_scan_result {
+    char* signature; /*!< The signature string as passed to sig_scan */
+    intptr_t offset; /*!< The offset passed to sig_scan */
+    unsigned int pid; /*!< The process the signature was found in */
+    intptr_t result; /*!< The value returned to Lua */
+} sig_scan_result;
+
+static sig_scan_result* sig_scan_cache = NULL; /*!< Latest successful scan of each signature in the current run */
+static size_t sig_scan_cache_size = 0; /*!< Number of cached scans */
+
+/**
+ * Forgets all the cached signature scan results.
+ *
+ * Called when a new auto splitter run starts.
+ */
+void sig_scan_cache_clear()
+{
+    for (size_t i = 0; i < sig_scan_cache_size; i++) {
+        free(sig_scan_cache[i].signature);
+    }
+    free(sig_scan_cache);
+    sig_scan_cache = NULL;
+    sig_scan_cache_size = 0;
+}
+
+/**
+ * Finds the cached scan of a signature in the attached process.
+ */
+static sig_scan_result* sig_scan_cache_entry(const char* signature, intptr_t offset)
+{
+    for (size_t i = 0; i < sig_scan_cache_size; i++) {
+        sig_scan_result* entry = &sig_scan_cache[i];
+        if (entry->pid == process.pid && entry->offset == offset && strcmp(entry->signature, signature) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Looks up the last successful scan of the same signature in the attached process.
+ *
+ * Only used while a hot reload re-executes the script, scripts scanning again at other
+ * times expect the data to have moved.
+ *
+ * @param[in] signature The signature string.
+ * @param[in] offset The offset passed to sig_scan.
+ * @param[out] result Where to store the cached result.
+ *
+ * @return True if the scan was found in the cache.
+ */
+static bool sig_scan_cache_find(const char* signature, intptr_t offset, intptr_t* result)
+{
+    if (!auto_splitter_reloading) {
+        return false;
+    }
+    sig_scan_result* entry = sig_scan_cache_entry(signature, offset);
+    if (entry) {
+        *result = entry->result;
+    }
+    return entry != NULL;
+}
+
+/**
+ * Stores a successful scan in the cache.
+ *
+ * @param[in] signature The signature string.
+ * @param[in] offset The offset passed to sig_scan.
+ * @param[in] result The result returned to Lua.
+ */
+static void sig_scan_cache_store(const char* signature, intptr_t offset, intptr_t result)
+{
+    sig_scan_result* entry = sig_scan_cache_entry(signature, offset);
+    if (entry) {
+        entry->result = result;
+        return;
+    }
+    sig_scan_result* temp = realloc(sig_scan_cache, (sig_scan_cache_size + 1) * sizeof(sig_scan_result));
+    if (!temp) {
+        return;
+    }
+    sig_scan_cache = temp;
+
+    char* signature_copy = strdup(signature);
+    if (!signature_copy) {
+        return;
+    }
+    sig_scan_cache[sig_scan_cache_size++] = (sig_scan_result) {
+        .signature = signature_copy,
+        .offset = offset,
+        .pid = process.pid,
+        .result = result,
+    };
+}
+
 /**
  * Error logging function
  *
@@ -85,87 +194,387 @@ ProcessMap* get_memory_regions(pid_t pid, int* count)
 }
 
 /**
- * Matches a pattern with an array of bytes.
+ * A signature compiled for scanning.
+ *
+ * Each byte of the pattern matches when `(data & mask) == value`, so nibbles can be
+ * wildcards on their own. The values are followed in memory by the masks.
+ */
+typedef struct Signature {
+    char* source; /*!< The signature string it was compiled from */
+    size_t length; /*!< Number of bytes in the pattern */
+    size_t anchor; /*!< The most selective byte, checked before the whole pattern */
+    size_t tail; /*!< The last byte that isn't a full wildcard, used for the skip table */
+    size_t skip[256]; /*!< How far the scan can move based on the byte at tail */
+    uint8_t bytes[]; /*!< The values, then the masks */
+} Signature;
+
+/**
+ * Parses a hexadecimal digit or nibble wildcard of a signature.
  *
- * @param[in] data The data to compare the pattern against.
- * @param[in] pattern The pattern to test for.
- * @param[in] pattern_size The length of the pattern.
+ * @param c The character.
+ * @param[out] value The value of the nibble.
+ * @param[out] mask 0xF for a digit, 0 for a wildcard.
  *
- * @return True if the pattern matches the data, false otherwise
+ * @return False if the character is neither.
  */
-bool match_pattern(const uint8_t* data, const uint16_t* pattern, size_t pattern_size)
+static bool parse_nibble(char c, uint8_t* value, uint8_t* mask)
 {
-    for (size_t i = 0; i < pattern_size; ++i) {
-        uint8_t byte = pattern[i] & 0xFF;
-        bool ignore = (pattern[i] >> 8) & 0x1;
-        if (!ignore && data[i] != byte) {
-            return false;
-        }
+    *mask = 0xF;
+    if (c >= '0' && c <= '9') {
+        *value = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        *value = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        *value = c - 'A' + 10;
+    } else if (c == '?') {
+        *value = 0;
+        *mask = 0;
+    } else {
+        return false;
     }
     return true;
 }
 
 /**
- * Converts an IDA-like signature into a pattern to be used in LibreSplit.
- * Supports the '??' string to ignore certain bytes in the comparison.
+ * Compiles an IDA-like signature into a pattern to be used in LibreSplit.
+ *
+ * Bytes are separated by spaces. `??` or `?` ignores a whole byte and a single `?`
+ * digit ignores that nibble only, like in `4?` or `?F`.
  *
- * @param[in] signature A string containing the signature to convert.
- * @param[out] pattern_size A pointer onto where to save the size of the pattern.
+ * @param[in] source A string containing the signature to compile.
  *
- * @return A pattern to be used with the LibreSplit signature scan functions.
+ * @return The compiled signature, to be freed with free_signature, or NULL if it's invalid.
  */
-uint16_t* convert_signature(const char* signature, size_t* pattern_size)
+static Signature* compile_signature(const char* source)
 {
-    char* signature_copy = strdup(signature);
-    if (!signature_copy) {
+    size_t source_length = strlen(source);
+    size_t max_length = source_length / 2 + 1;
+    Signature* signature = malloc(sizeof(Signature) + 2 * max_length);
+    char* source_copy = strdup(source);
+    if (!signature || !source_copy) {
+        free(signature);
+        free(source_copy);
         return NULL;
     }
+    signature->source = source_copy;
+
+    // The masks are moved right after the values once the length is known
+    uint8_t* values = signature->bytes;
+    uint8_t* masks = signature->bytes + max_length;
+    size_t length = 0;
+    for (const char* c = source; *c;) {
+        if (*c == ' ') {
+            c++;
+            continue;
+        }
+
+        size_t token_length = strcspn(c, " ");
+        uint8_t high, high_mask, low, low_mask;
+        bool valid;
+        if (token_length == 1) {
+            // A single digit is a whole byte, a single ? a whole wildcard
+            high = 0;
+            high_mask = *c == '?' ? 0 : 0xF;
+            valid = parse_nibble(c[0], &low, &low_mask);
+        } else {
+            valid = token_length == 2 && parse_nibble(c[0], &high, &high_mask) && parse_nibble(c[1], &low, &low_mask);
+        }
+        if (!valid) {
+            log_error("Invalid signature byte '%.*s'", (int)token_length, c);
+            free(source_copy);
+            free(signature);
+            return NULL;
+        }
+        values[length] = high << 4 | low;
+        masks[length] = high_mask << 4 | low_mask;
+        length++;
+        c += token_length;
+    }
 
-    char* token = strtok(signature_copy, " ");
-    size_t size = 0;
-    size_t capacity = 10;
-    uint16_t* pattern = (uint16_t*)malloc(capacity * sizeof(uint16_t));
-    if (!pattern) {
-        free(signature_copy);
+    if (length == 0) {
+        free(source_copy);
+        free(signature);
         return NULL;
     }
+    signature->length = length;
+    memmove(values + length, masks, length);
+    masks = values + length;
+
+    // Check first a fully known byte, preferring uncommon ones over padding and nops
+    size_t anchor = 0;
+    int best_score = -1;
+    for (size_t i = 0; i < length; i++) {
+        int score = masks[i] == 0xFF ? 2 : masks[i] != 0;
+        if (masks[i] == 0xFF && values[i] != 0x00 && values[i] != 0xFF && values[i] != 0xCC && values[i] != 0x90) {
+            score++;
+        }
+        if (score > best_score) {
+            best_score = score;
+            anchor = i;
+        }
+    }
+    signature->anchor = anchor;
 
-    while (token != NULL) {
-        if (size >= capacity) {
-            capacity *= 2;
-            uint16_t* temp = (uint16_t*)realloc(pattern, capacity * sizeof(uint16_t));
-            if (!temp) {
-                free(pattern);
-                free(signature_copy);
-                return NULL;
+    // Horspool skip table over the pattern up to its last non wildcard byte
+    size_t tail = length - 1;
+    while (tail > 0 && masks[tail] == 0) {
+        tail--;
+    }
+    signature->tail = tail;
+    for (int byte = 0; byte < 256; byte++) {
+        signature->skip[byte] = tail + 1;
+    }
+    for (size_t i = 0; i < tail; i++) {
+        for (int byte = 0; byte < 256; byte++) {
+            if ((byte & masks[i]) == values[i]) {
+                signature->skip[byte] = tail - i;
             }
-            pattern = temp;
         }
+    }
+    return signature;
+}
 
-        if (strstr(token, "?") != NULL) {
-            // Treats a half-byte mask as a full-byte mask (0? => ?? or ?F=> ??)
-            pattern[size] = 0xFF00; // Set the upper byte to 1 to indicate ignoring this byte
-        } else {
-            pattern[size] = strtol(token, NULL, 16);
+/**
+ * Copies a compiled signature, so it can outlive the Lua object it came from.
+ *
+ * @return The copy, or NULL if out of memory.
+ */
+static Signature* copy_signature(const Signature* signature)
+{
+    size_t size = sizeof(Signature) + 2 * signature->length;
+    Signature* copy = malloc(size);
+    char* source_copy = strdup(signature->source);
+    if (!copy || !source_copy) {
+        free(copy);
+        free(source_copy);
+        return NULL;
+    }
+    memcpy(copy, signature, size);
+    copy->source = source_copy;
+    return copy;
+}
+
+/**
+ * Frees a compiled signature.
+ */
+static void free_signature(Signature* signature)
+{
+    if (signature) {
+        free(signature->source);
+        free(signature);
+    }
+}
+
+/**
+ * Matches a signature with an array of bytes.
+ *
+ * @param[in] data The data to compare the signature against.
+ * @param[in] signature The signature to test for.
+ *
+ * @return True if the signature matches the data, false otherwise
+ */
+static bool match_pattern(const uint8_t* data, const Signature* signature)
+{
+    const uint8_t* values = signature->bytes;
+    const uint8_t* masks = signature->bytes + signature->length;
+    for (size_t i = 0; i < signature->length; ++i) {
+        if ((data[i] & masks[i]) != values[i]) {
+            return false;
         }
-        size++;
-        token = strtok(NULL, " ");
+    }
+    return true;
+}
+
+/**
+ * Finds the first match of a signature in a buffer.
+ *
+ * @param[in] data The buffer.
+ * @param[in] size The size of the buffer.
+ * @param[in] signature The signature to look for.
+ * @param[out] index The position of the match.
+ *
+ * @return True if the signature was found.
+ */
+static bool find_pattern(const uint8_t* data, size_t size, const Signature* signature, size_t* index)
+{
+    if (size < signature->length) {
+        return false;
     }
 
-    free(signature_copy);
-    *pattern_size = size;
-    return pattern;
+    const uint8_t anchor_value = signature->bytes[signature->anchor];
+    const uint8_t anchor_mask = signature->bytes[signature->length + signature->anchor];
+    size_t last = size - signature->length;
+    for (size_t position = 0; position <= last; position += signature->skip[data[position + signature->tail]]) {
+        const uint8_t* candidate = data + position;
+        if ((candidate[signature->anchor] & anchor_mask) == anchor_value && match_pattern(candidate, signature)) {
+            *index = position;
+            return true;
+        }
+    }
+    return false;
 }
 
-bool validate_process_memory(pid_t pid, uintptr_t address, void* buffer, size_t size)
+bool validate_process_memory(uintptr_t address, void* buffer, size_t size)
 {
-    struct iovec local_iov = { buffer, size };
-    struct iovec remote_iov = { (void*)address, size };
-    ssize_t nread = process_vm_readv(pid, &local_iov, 1, &remote_iov, 1, 0);
+    // Only the result of the scan is recorded, not the whole memory it went through
+    ssize_t nread = read_process_memory_direct(address, buffer, size);
 
     return nread == (ssize_t)size;
 }
 
+/**
+ * Scans the memory of the game process for a signature.
+ *
+ * Only uses its arguments, so it can run on the background scan thread.
+ *
+ * @param[in] signature The compiled signature to look for.
+ * @param[in] offset The offset to add to the found address.
+ * @param[in] pid The game process.
+ * @param[in] base_address The base address of the game process.
+ * @param[in] cancel If not NULL, the scan stops as soon as it becomes true.
+ * @param[out] result The found address, offset by base_address.
+ *
+ * @return True if the signature was found.
+ */
+static bool scan_memory(const Signature* signature, intptr_t offset, pid_t pid, uintptr_t base_address, atomic_bool* cancel, intptr_t* result)
+{
+    *result = 0;
+
+    int regions_count = 0;
+    ProcessMap* regions = get_memory_regions(pid, &regions_count);
+    if (!regions) {
+        log_error("Failed to get memory regions");
+        return false;
+    }
+
+    for (int i = 0; i < regions_count; i++) {
+        if (cancel && atomic_load(cancel)) {
+            free(regions);
+            return false;
+        }
+
+        ProcessMap region = regions[i];
+        ssize_t region_size = region.end - region.start;
+        uint8_t* buffer = malloc(region_size);
+        if (!buffer) {
+            free(regions);
+            log_error("Failed to allocate memory for region buffer");
+            return false;
+        }
+
+        if (!validate_process_memory(region.start, buffer, region_size)) {
+            free(buffer);
+            continue; // Continue to next region
+        }
+
+        size_t j;
+        if (find_pattern(buffer, region_size, signature, &j)) {
+            // The resulting address is the start of the region
+            // plus the index of the first byte that matches
+            // plus the user-set offset, minus the process's base_address
+            // or a subsequent memory read will read the wrong address or
+            // go out of memory (due to commit 2b4417f offsetting memory reads)
+            // So this result might be negative if the main module happens to be after
+            // the found signature. This should be corrected by readAddress.
+            *result = (region.start + j + offset) - base_address;
+
+            free(buffer);
+            free(regions);
+            return true;
+        }
+
+        free(buffer);
+    }
+
+    free(regions);
+
+    // No match found
+    log_error("No match found for the given signature");
+    return false;
+}
+
+/**
+ * Validates the (signature, offset) arguments of sig_scan and sig_scan_async.
+ *
+ * The signature can be either a string or a signature returned by compileSignature.
+ *
+ * @param L The lua state.
+ * @param[out] offset The offset.
+ * @param[out] owned True if the returned signature was compiled here and must be freed.
+ *
+ * @return The signature, or NULL if the arguments are invalid.
+ */
+static Signature* check_scan_arguments(lua_State* L, intptr_t* offset, bool* owned)
+{
+    if (lua_gettop(L) != 2) {
+        log_error("Invalid number of arguments: expected 2 (signature, offset)");
+        return NULL;
+    }
+
+    bool compiled = lua_type(L, 1) == LUA_TUSERDATA;
+    if ((!compiled && !lua_isstring(L, 1)) || !lua_isnumber(L, 2)) {
+        log_error("Invalid argument types: expected (string, number)");
+        return NULL;
+    }
+
+    *offset = lua_tointeger(L, 2);
+    if (compiled) {
+        *owned = false;
+        return *(Signature**)luaL_checkudata(L, 1, SIGNATURE_METATABLE);
+    }
+
+    // Validate signature string
+    const char* source = lua_tostring(L, 1);
+    if (strlen(source) == 0) {
+        log_error("Signature string cannot be empty");
+        return NULL;
+    }
+
+    Signature* signature = compile_signature(source);
+    if (!signature) {
+        log_error("Failed to convert signature");
+        return NULL;
+    }
+    *owned = true;
+    return signature;
+}
+
+/**
+ * Finds a signature in the game process, on the auto splitter thread.
+ *
+ * Successful scans are cached for hot reloads. When recording or replaying, the outcome is recorded or
+ * read from the recording instead of scanning.
+ *
+ * @param[in] signature The compiled signature to look for.
+ * @param[in] offset The offset to add to the found address.
+ * @param[out] result The found address, offset by the process base_address.
+ *
+ * @return True if the signature was found.
+ */
+static bool find_signature(const Signature* signature, intptr_t offset, intptr_t* result)
+{
+    // A hot reload re-executes the script, which usually scans again for the same signatures
+    if (sig_scan_cache_find(signature->source, offset, result)) {
+        return true;
+    }
+
+    bool found;
+    if (replay_mode == REPLAY_REPLAYING) {
+        bool recorded_found;
+        found = replay_read_sig_scan(&recorded_found, result) && recorded_found;
+    } else {
+        found = scan_memory(signature, offset, process.pid, process.base_address, NULL, result);
+        if (replay_mode == REPLAY_RECORDING) {
+            replay_record_sig_scan(found, *result);
+        }
+    }
+
+    if (found) {
+        sig_scan_cache_store(signature->source, offset, *result);
+    }
+    return found;
+}
+
 /**
  * Performs the Lua Auto Splitter sig_scan function, pushing onto the Lua stack the result.
  *
@@ -179,93 +588,411 @@ bool validate_process_memory(pid_t pid, uintptr_t address, void* buffer, size_t
  *
  * @return Always 1 (one parameter is always pushed on the stack, either the address or nil)
  */
-int perform_sig_scan(lua_State* L)
+static int sig_scan(lua_State* L)
 {
-    if (lua_gettop(L) != 2) {
-        log_error("Invalid number of arguments: expected 2 (signature, offset)");
+    intptr_t offset;
+    bool owned;
+    Signature* signature = check_scan_arguments(L, &offset, &owned);
+    if (!signature) {
         lua_pushnil(L);
         return 1;
     }
 
-    if (!lua_isstring(L, 1) || !lua_isnumber(L, 2)) {
-        log_error("Invalid argument types: expected (string, number)");
+    intptr_t result;
+    bool found = find_signature(signature, offset, &result);
+    if (owned) {
+        free_signature(signature);
+    }
+    if (!found) {
         lua_pushnil(L);
         return 1;
     }
+    lua_pushnumber(L, result);
+    return 1;
+}
 
-    pid_t p_pid = process.pid;
-    const char* signature = lua_tostring(L, 1);
-    intptr_t offset = lua_tointeger(L, 2);
+/**
+ * The sig_scan Lua function, timed by the profiler.
+ *
+ * @see sig_scan
+ *
+ * @param L The lua state.
+ *
+ * @return Always 1.
+ */
+int perform_sig_scan(lua_State* L)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int results = sig_scan(L);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    profiler_record(PROFILE_SIG_SCAN, (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
+    return results;
+}
 
-    // Validate signature string
-    if (strlen(signature) == 0) {
-        log_error("Signature string cannot be empty");
+#define SCAN_METATABLE "LASR.Scan"
+
+/**
+ * State of a background signature scan.
+ */
+typedef enum ScanState {
+    SCAN_PENDING, /*!< Queued or running */
+    SCAN_DONE, /*!< Finished, found tells whether the signature was found */
+    SCAN_CANCELLED, /*!< Cancelled before finishing */
+} ScanState;
+
+/**
+ * A signature scan run on the background scan thread.
+ *
+ * Shared between the Lua handle and the scan queue, freed when both let it go.
+ */
+typedef struct ScanJob {
+    Signature* signature; /*!< Owned copy of the signature */
+    intptr_t offset; /*!< The offset passed to sig_scan_async */
+    pid_t pid; /*!< The process to scan */
+    uintptr_t base_address; /*!< The base address of the process */
+    atomic_int state; /*!< A ScanState, the result is valid once it's SCAN_DONE */
+    atomic_bool cancel; /*!< Set to stop the scan */
+    atomic_int references; /*!< Holders of the job */
+    bool found; /*!< Whether the signature was found */
+    intptr_t result; /*!< The found address, offset by base_address */
+    bool cached; /*!< Whether the result was stored in the scan cache */
+    struct ScanJob* next; /*!< Next job in the queue */
+} ScanJob;
+
+static pthread_mutex_t scan_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scan_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t scan_thread;
+static bool scan_thread_running = false; /*!< Only touched by the auto splitter thread */
+static bool scan_shutdown = false; /*!< Tells the scan thread to exit */
+static ScanJob* scan_queue_head = NULL; /*!< Next job to run */
+static ScanJob* scan_queue_tail = NULL; /*!< Last queued job */
+static ScanJob* scan_running = NULL; /*!< The job being scanned */
+
+/**
+ * Lets go of a scan job, freeing it if nobody else holds it.
+ */
+static void scan_job_release(ScanJob* job)
+{
+    if (atomic_fetch_sub(&job->references, 1) == 1) {
+        free_signature(job->signature);
+        free(job);
+    }
+}
+
+/**
+ * The background scan thread, running the queued scans one at a time.
+ */
+static void* scan_worker(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&scan_mutex);
+    while (true) {
+        while (!scan_queue_head && !scan_shutdown) {
+            pthread_cond_wait(&scan_cond, &scan_mutex);
+        }
+        if (scan_shutdown) {
+            break;
+        }
+
+        ScanJob* job = scan_queue_head;
+        scan_queue_head = job->next;
+        if (!scan_queue_head) {
+            scan_queue_tail = NULL;
+        }
+        scan_running = job;
+        pthread_mutex_unlock(&scan_mutex);
+
+        if (!atomic_load(&job->cancel)) {
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            job->found = scan_memory(job->signature, job->offset, job->pid, job->base_address, &job->cancel, &job->result);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            profiler_record(PROFILE_SIG_SCAN, (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
+        }
+        atomic_store(&job->state, atomic_load(&job->cancel) ? SCAN_CANCELLED : SCAN_DONE);
+
+        pthread_mutex_lock(&scan_mutex);
+        scan_running = NULL;
+        scan_job_release(job);
+    }
+    pthread_mutex_unlock(&scan_mutex);
+    return NULL;
+}
+
+/**
+ * Queues a job on the background scan thread, starting it if needed.
+ *
+ * @return False if the scan thread couldn't be started.
+ */
+static bool scan_queue(ScanJob* job)
+{
+    if (!scan_thread_running) {
+        scan_shutdown = false;
+        if (pthread_create(&scan_thread, NULL, scan_worker, NULL) != 0) {
+            return false;
+        }
+        scan_thread_running = true;
+    }
+
+    atomic_fetch_add(&job->references, 1);
+    pthread_mutex_lock(&scan_mutex);
+    if (scan_queue_tail) {
+        scan_queue_tail->next = job;
+    } else {
+        scan_queue_head = job;
+    }
+    scan_queue_tail = job;
+    pthread_cond_signal(&scan_cond);
+    pthread_mutex_unlock(&scan_mutex);
+    return true;
+}
+
+/**
+ * Cancels all the background scans and waits for the scan thread to exit.
+ *
+ * Called when the auto splitter stops, so no scan outlives the process it was reading.
+ */
+void sig_scan_async_shutdown()
+{
+    if (!scan_thread_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&scan_mutex);
+    scan_shutdown = true;
+    if (scan_running) {
+        atomic_store(&scan_running->cancel, true);
+    }
+    while (scan_queue_head) {
+        ScanJob* job = scan_queue_head;
+        scan_queue_head = job->next;
+        atomic_store(&job->state, SCAN_CANCELLED);
+        scan_job_release(job);
+    }
+    scan_queue_tail = NULL;
+    pthread_cond_signal(&scan_cond);
+    pthread_mutex_unlock(&scan_mutex);
+
+    pthread_join(scan_thread, NULL);
+    scan_thread_running = false;
+}
+
+/**
+ * The "done" method of scan handles.
+ *
+ * @return Always 1, true once the scan finished or was cancelled.
+ */
+static int scan_done(lua_State* L)
+{
+    ScanJob* job = *(ScanJob**)luaL_checkudata(L, 1, SCAN_METATABLE);
+    lua_pushboolean(L, atomic_load(&job->state) != SCAN_PENDING);
+    return 1;
+}
+
+/**
+ * The "result" method of scan handles.
+ *
+ * @return Always 1, the same address sig_scan would return, or nil if the scan isn't done,
+ * was cancelled or didn't find the signature.
+ */
+static int scan_result(lua_State* L)
+{
+    ScanJob* job = *(ScanJob**)luaL_checkudata(L, 1, SCAN_METATABLE);
+    if (atomic_load(&job->state) != SCAN_DONE || !job->found) {
         lua_pushnil(L);
         return 1;
     }
+    if (!job->cached) {
+        job->cached = true;
+        sig_scan_cache_store(job->signature->source, job->offset, job->result);
+    }
+    lua_pushnumber(L, job->result);
+    return 1;
+}
 
-    size_t pattern_length;
-    uint16_t* pattern = convert_signature(signature, &pattern_length);
-    if (!pattern) {
-        log_error("Failed to convert signature");
+/**
+ * The "cancel" method of scan handles, stopping the scan as soon as possible.
+ *
+ * @return Always zero.
+ */
+static int scan_cancel(lua_State* L)
+{
+    ScanJob* job = *(ScanJob**)luaL_checkudata(L, 1, SCAN_METATABLE);
+    atomic_store(&job->cancel, true);
+    return 0;
+}
+
+/**
+ * The __gc metamethod of scan handles, cancelling scans nobody is waiting for.
+ *
+ * @return Always zero.
+ */
+static int scan_gc(lua_State* L)
+{
+    ScanJob** handle = luaL_checkudata(L, 1, SCAN_METATABLE);
+    if (*handle) {
+        atomic_store(&(*handle)->cancel, true);
+        scan_job_release(*handle);
+        *handle = NULL;
+    }
+    return 0;
+}
+
+/**
+ * The "sig_scan_async" Lua Auto Splitter Runtime function.
+ *
+ * Takes the same arguments as sig_scan, but returns right away with a handle to the scan,
+ * which runs on a background thread. The handle has the methods:
+ * - `done()`: true once the scan is over.
+ * - `result()`: what sig_scan would have returned, nil until the scan is done.
+ * - `cancel()`: stops the scan.
+ *
+ * When recording or replaying, the scan runs right away like sig_scan, so the recording
+ * doesn't depend on how long it took.
+ *
+ * @param L The lua state.
+ *
+ * @return Always 1, the handle or nil if the arguments are invalid.
+ */
+int sig_scan_async(lua_State* L)
+{
+    intptr_t offset;
+    bool owned;
+    Signature* signature = check_scan_arguments(L, &offset, &owned);
+    if (!signature) {
         lua_pushnil(L);
         return 1;
     }
 
-    int regions_count = 0;
-    ProcessMap* regions = get_memory_regions(p_pid, &regions_count);
-    if (!regions) {
-        free(pattern);
-        log_error("Failed to get memory regions");
+    // The job keeps its own signature, the compiled one could be collected during the scan
+    ScanJob* job = calloc(1, sizeof(ScanJob));
+    Signature* job_signature = owned ? signature : copy_signature(signature);
+    if (!job || !job_signature) {
+        free(job);
+        free_signature(job_signature);
+        log_error("Failed to allocate the scan");
         lua_pushnil(L);
         return 1;
     }
+    job->signature = job_signature;
+    job->offset = offset;
+    job->pid = process.pid;
+    job->base_address = process.base_address;
+    atomic_init(&job->state, SCAN_PENDING);
+    atomic_init(&job->cancel, false);
+    atomic_init(&job->references, 1);
+
+    ScanJob** handle = lua_newuserdata(L, sizeof(ScanJob*));
+    *handle = job;
+    luaL_getmetatable(L, SCAN_METATABLE);
+    lua_setmetatable(L, -2);
+
+    // Cached results and recordings don't need the scan thread
+    if (replay_mode != REPLAY_OFF || sig_scan_cache_find(job_signature->source, offset, &job->result) || !scan_queue(job)) {
+        job->found = find_signature(job_signature, offset, &job->result);
+        job->cached = true;
+        atomic_store(&job->state, SCAN_DONE);
+    }
+    return 1;
+}
 
-    for (int i = 0; i < regions_count; i++) {
-        ProcessMap region = regions[i];
-        ssize_t region_size = region.end - region.start;
-        uint8_t* buffer = malloc(region_size);
-        if (!buffer) {
-            free(pattern);
-            free(regions);
-            log_error("Failed to allocate memory for region buffer");
-            lua_pushnil(L);
-            return 1;
-        }
-
-        if (!validate_process_memory(p_pid, region.start, buffer, region_size)) {
-            free(buffer);
-            continue; // Continue to next region
-        }
+/**
+ * The __gc metamethod of compiled signatures.
+ *
+ * @return Always zero.
+ */
+static int signature_gc(lua_State* L)
+{
+    Signature** handle = luaL_checkudata(L, 1, SIGNATURE_METATABLE);
+    free_signature(*handle);
+    *handle = NULL;
+    return 0;
+}
 
-        for (size_t j = 0; j <= region_size - pattern_length; ++j) {
-            if (match_pattern(buffer + j, pattern, pattern_length)) {
-                // The resulting address is the start of the region
-                // plus the index of the first byte that matches
-                // plus the user-set offset, minus the process's base_address
-                // or a subsequent memory read will read the wrong address or
-                // go out of memory (due to commit 2b4417f offsetting memory reads)
-                // So this result might be negative if the main module happens to be after
-                // the found signature. This should be corrected by readAddress.
-                intptr_t result = (region.start + j + offset) - process.base_address;
-
-                free(buffer);
-                free(pattern);
-                free(regions);
+/**
+ * The __tostring metamethod of compiled signatures, giving back the signature string.
+ *
+ * @return Always 1.
+ */
+static int signature_tostring(lua_State* L)
+{
+    Signature** handle = luaL_checkudata(L, 1, SIGNATURE_METATABLE);
+    lua_pushstring(L, (*handle)->source);
+    return 1;
+}
 
-                lua_pushnumber(L, result);
-                return 1;
-            }
-        }
+/**
+ * The "compileSignature" Lua Auto Splitter Runtime function.
+ *
+ * Parses a signature once, so it can be passed to sig_scan and sig_scan_async
+ * many times without parsing it again.
+ *
+ * @param L The lua state.
+ *
+ * @return Always 1, the compiled signature or nil if it's invalid.
+ */
+int compileSignature(lua_State* L)
+{
+    const char* source = lua_tostring(L, 1);
+    if (!source || strlen(source) == 0) {
+        log_error("compileSignature expects a signature string");
+        lua_pushnil(L);
+        return 1;
+    }
 
-        free(buffer);
+    Signature** handle = lua_newuserdata(L, sizeof(Signature*));
+    *handle = compile_signature(source);
+    if (!*handle) {
+        lua_pushnil(L);
+        return 1;
     }
+    luaL_getmetatable(L, SIGNATURE_METATABLE);
+    lua_setmetatable(L, -2);
+    return 1;
+}
 
-    free(pattern);
-    free(regions);
+/**
+ * Waits for a scan from a coroutine, yielding every tick until it's done.
+ */
+static const char await_scan_source[] = "local handle = ...\n"
+                                        "while not handle:done() do\n"
+                                        "    coroutine.yield()\n"
+                                        "end\n"
+                                        "return handle:result()\n";
 
-    // No match found
-    log_error("No match found for the given signature");
-    lua_pushnil(L);
-    return 1;
+/**
+ * Creates the metatables of scan handles and compiled signatures, and the awaitScan helper.
+ *
+ * @param L The lua state.
+ */
+void sig_scan_register(lua_State* L)
+{
+    static const luaL_Reg methods[] = {
+        { "done", scan_done },
+        { "result", scan_result },
+        { "cancel", scan_cancel },
+        { NULL, NULL }
+    };
+
+    luaL_newmetatable(L, SCAN_METATABLE);
+    lua_newtable(L);
+    luaL_register(L, NULL, methods);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, scan_gc);
+    lua_setfield(L, -2, "__gc");
+    lua_pop(L, 1);
+
+    luaL_newmetatable(L, SIGNATURE_METATABLE);
+    lua_pushcfunction(L, signature_gc);
+    lua_setfield(L, -2, "__gc");
+    lua_pushcfunction(L, signature_tostring);
+    lua_setfield(L, -2, "__tostring");
+    lua_pop(L, 1);
+
+    if (luaL_loadbuffer(L, await_scan_source, sizeof(await_scan_source) - 1, "=awaitScan") == 0) {
+        lua_setglobal(L, "awaitScan");
+    } else {
+        lua_pop(L, 1);
+    }
 }
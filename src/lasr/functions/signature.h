@@ -3,3 +3,8 @@
 #include <lua.h>
 
 int perform_sig_scan(lua_State* L);
+int compileSignature(lua_State* L);
+int sig_scan_async(lua_State* L);
+void sig_scan_async_shutdown();
+void sig_scan_register(lua_State* L);
+void sig_scan_cache_clear();
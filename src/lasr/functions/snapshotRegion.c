@@ -0,0 +1,70 @@
+#include "snapshotRegion.h"
+
+#include "../snapshot/snapshot.h"
+#include "../utils.h"
+#include "readAddress.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * The "addSnapshotRegion" Lua Auto Splitter Runtime function.
+ *
+ * Takes the size of the region followed by the same address arguments as readAddress.
+ * The pointer chain is resolved once, then the region is copied at the start of every
+ * tick and the reads inside it are served from the copy.
+ *
+ * @param L The Lua state.
+ *
+ * @return Always 1, the id of the region or nil on error.
+ */
+int addSnapshotRegion(lua_State* L)
+{
+    lua_Integer size = lua_tointeger(L, 1);
+    if (!lua_isnumber(L, 1) || size < 1 || size > SNAPSHOT_MAX_SIZE) {
+        printf("[addSnapshotRegion] The size must be between 1 and %d bytes\n", SNAPSHOT_MAX_SIZE);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    if (lua_isnil(L, 2)) {
+        printf("[addSnapshotRegion] The address argument cannot be nil. Check your auto splitter code.\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    memory_error = false;
+    int32_t error = 0;
+    uint64_t address;
+    if (!resolve_address(L, 2, &address, &error)) {
+        handle_memory_error(error);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    int id = snapshot_add(address, size);
+    if (id == 0) {
+        printf("[addSnapshotRegion] Too many regions, up to %d regions and %d bytes in total are allowed\n", SNAPSHOT_MAX_REGIONS, SNAPSHOT_MAX_SIZE);
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushinteger(L, id);
+    return 1;
+}
+
+/**
+ * The "removeSnapshotRegion" Lua Auto Splitter Runtime function.
+ *
+ * Takes the id returned by addSnapshotRegion and stops copying that region.
+ *
+ * @param L The Lua state.
+ *
+ * @return Always zero.
+ */
+int removeSnapshotRegion(lua_State* L)
+{
+    if (!lua_isnumber(L, 1) || !snapshot_remove(lua_tointeger(L, 1))) {
+        printf("[removeSnapshotRegion] Unknown region\n");
+    }
+    return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <lua.h>
+
+int addSnapshotRegion(lua_State* L);
+int removeSnapshotRegion(lua_State* L);
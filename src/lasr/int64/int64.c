@@ -0,0 +1,347 @@
+/** \file int64.c
+ *
+ * Boxed 64 bit integers for the Lua Auto Splitter Runtime
+ *
+ * Lua numbers are doubles, which can only hold integers up to 2^53 exactly, so pointers
+ * and big counters lose their lowest bits when read as plain numbers. These userdata
+ * keep the full value and support arithmetic, comparisons and the bitwise helpers.
+ */
+#include "int64.h"
+
+#include <inttypes.h>
+#include <lauxlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Largest magnitude a double holds without losing precision
+#define EXACT_DOUBLE_LIMIT (1ULL << 53)
+
+/**
+ * Gets the boxed integer at the given index.
+ *
+ * @return The boxed integer, or NULL if the value is something else.
+ */
+static LasrInt64* to_boxed(lua_State* L, int index)
+{
+    LasrInt64* value = lua_touserdata(L, index);
+    if (!value || !lua_getmetatable(L, index)) {
+        return NULL;
+    }
+    luaL_getmetatable(L, INT64_METATABLE);
+    bool boxed = lua_rawequal(L, -1, -2);
+    lua_pop(L, 2);
+    return boxed ? value : NULL;
+}
+
+/**
+ * Pushes a boxed 64 bit integer.
+ *
+ * @param L The Lua state.
+ * @param bits The value, as two's complement for signed integers.
+ * @param is_unsigned Whether the value is a uint64.
+ */
+void int64_push(lua_State* L, uint64_t bits, bool is_unsigned)
+{
+    LasrInt64* value = lua_newuserdata(L, sizeof(LasrInt64));
+    value->bits = bits;
+    value->is_unsigned = is_unsigned;
+    luaL_getmetatable(L, INT64_METATABLE);
+    lua_setmetatable(L, -2);
+}
+
+/**
+ * Pushes a 64 bit integer as a plain number if a double can hold it exactly,
+ * boxed otherwise.
+ *
+ * @param L The Lua state.
+ * @param bits The value, as two's complement for signed integers.
+ * @param is_unsigned Whether the value is a uint64.
+ */
+void int64_push_exact(lua_State* L, uint64_t bits, bool is_unsigned)
+{
+    if (is_unsigned) {
+        if (bits <= EXACT_DOUBLE_LIMIT) {
+            lua_pushnumber(L, (lua_Number)bits);
+            return;
+        }
+    } else {
+        int64_t value = (int64_t)bits;
+        if (value >= -(int64_t)EXACT_DOUBLE_LIMIT && value <= (int64_t)EXACT_DOUBLE_LIMIT) {
+            lua_pushnumber(L, (lua_Number)value);
+            return;
+        }
+    }
+    int64_push(L, bits, is_unsigned);
+}
+
+/**
+ * Checks whether the value at the given index is a boxed 64 bit integer.
+ *
+ * @param L The Lua state.
+ * @param index The stack index.
+ */
+bool int64_is_boxed(lua_State* L, int index)
+{
+    return to_boxed(L, index) != NULL;
+}
+
+/**
+ * Gets an integer argument, either a plain number or a boxed 64 bit integer.
+ *
+ * Plain numbers are read as signed integers.
+ *
+ * @param L The Lua state.
+ * @param index The stack index of the argument.
+ * @param[out] value The integer.
+ *
+ * @return False if the argument is not an integer.
+ */
+bool int64_check(lua_State* L, int index, LasrInt64* value)
+{
+    if (lua_type(L, index) == LUA_TNUMBER) {
+        lua_Number number = lua_tonumber(L, index);
+        value->bits = number >= 0 ? (uint64_t)number : (uint64_t)(int64_t)number;
+        value->is_unsigned = false;
+        return true;
+    }
+    LasrInt64* boxed = to_boxed(L, index);
+    if (!boxed) {
+        return false;
+    }
+    *value = *boxed;
+    return true;
+}
+
+/**
+ * Gets both operands of a binary metamethod.
+ *
+ * The result is unsigned if either operand is, like in C.
+ *
+ * @return Whether the operation is unsigned.
+ */
+static bool check_operands(lua_State* L, LasrInt64* a, LasrInt64* b)
+{
+    if (!int64_check(L, 1, a) || !int64_check(L, 2, b)) {
+        luaL_error(L, "attempt to perform arithmetic between a 64 bit integer and a %s",
+            luaL_typename(L, int64_is_boxed(L, 1) ? 2 : 1));
+    }
+    return a->is_unsigned || b->is_unsigned;
+}
+
+static int int64_add(lua_State* L)
+{
+    LasrInt64 a, b;
+    bool is_unsigned = check_operands(L, &a, &b);
+    int64_push(L, a.bits + b.bits, is_unsigned);
+    return 1;
+}
+
+static int int64_sub(lua_State* L)
+{
+    LasrInt64 a, b;
+    bool is_unsigned = check_operands(L, &a, &b);
+    int64_push(L, a.bits - b.bits, is_unsigned);
+    return 1;
+}
+
+static int int64_mul(lua_State* L)
+{
+    LasrInt64 a, b;
+    bool is_unsigned = check_operands(L, &a, &b);
+    int64_push(L, a.bits * b.bits, is_unsigned);
+    return 1;
+}
+
+/**
+ * Integer division and modulo, truncating toward zero like C.
+ */
+static int int64_divmod(lua_State* L, bool modulo)
+{
+    LasrInt64 a, b;
+    bool is_unsigned = check_operands(L, &a, &b);
+    if (b.bits == 0) {
+        return luaL_error(L, "attempt to divide a 64 bit integer by zero");
+    }
+
+    uint64_t result;
+    if (is_unsigned) {
+        result = modulo ? a.bits % b.bits : a.bits / b.bits;
+    } else if ((int64_t)a.bits == INT64_MIN && (int64_t)b.bits == -1) {
+        // Overflows, wrap around like the other operations
+        result = modulo ? 0 : a.bits;
+    } else {
+        int64_t x = (int64_t)a.bits, y = (int64_t)b.bits;
+        result = (uint64_t)(modulo ? x % y : x / y);
+    }
+    int64_push(L, result, is_unsigned);
+    return 1;
+}
+
+static int int64_div(lua_State* L)
+{
+    return int64_divmod(L, false);
+}
+
+static int int64_mod(lua_State* L)
+{
+    return int64_divmod(L, true);
+}
+
+static int int64_unm(lua_State* L)
+{
+    LasrInt64* a = luaL_checkudata(L, 1, INT64_METATABLE);
+    int64_push(L, 0 - a->bits, a->is_unsigned);
+    return 1;
+}
+
+/**
+ * Compares two integers.
+ *
+ * @return Negative, zero or positive if a is respectively lower, equal or greater than b.
+ */
+static int compare(lua_State* L)
+{
+    LasrInt64 a, b;
+    if (!int64_check(L, 1, &a) || !int64_check(L, 2, &b)) {
+        return luaL_error(L, "attempt to compare a 64 bit integer with a %s",
+            luaL_typename(L, int64_is_boxed(L, 1) ? 2 : 1));
+    }
+    if (a.is_unsigned || b.is_unsigned) {
+        return (a.bits > b.bits) - (a.bits < b.bits);
+    }
+    int64_t x = (int64_t)a.bits, y = (int64_t)b.bits;
+    return (x > y) - (x < y);
+}
+
+static int int64_eq(lua_State* L)
+{
+    lua_pushboolean(L, compare(L) == 0);
+    return 1;
+}
+
+static int int64_lt(lua_State* L)
+{
+    lua_pushboolean(L, compare(L) < 0);
+    return 1;
+}
+
+static int int64_le(lua_State* L)
+{
+    lua_pushboolean(L, compare(L) <= 0);
+    return 1;
+}
+
+static int int64_tostring(lua_State* L)
+{
+    LasrInt64* a = luaL_checkudata(L, 1, INT64_METATABLE);
+    char buffer[24];
+    if (a->is_unsigned) {
+        snprintf(buffer, sizeof(buffer), "%" PRIu64, a->bits);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%" PRId64, (int64_t)a->bits);
+    }
+    lua_pushstring(L, buffer);
+    return 1;
+}
+
+/**
+ * The "tonumber" method, converting to a plain number, possibly losing precision.
+ */
+static int int64_tonumber(lua_State* L)
+{
+    LasrInt64* a = luaL_checkudata(L, 1, INT64_METATABLE);
+    lua_pushnumber(L, a->is_unsigned ? (lua_Number)a->bits : (lua_Number)(int64_t)a->bits);
+    return 1;
+}
+
+/**
+ * The "hex" method, formatting the value as hexadecimal like Cheat Engine shows addresses.
+ */
+static int int64_hex(lua_State* L)
+{
+    LasrInt64* a = luaL_checkudata(L, 1, INT64_METATABLE);
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "0x%" PRIX64, a->bits);
+    lua_pushstring(L, buffer);
+    return 1;
+}
+
+/**
+ * Creates a boxed integer from a number, another boxed integer or a string,
+ * which can be hexadecimal with a 0x prefix.
+ */
+static int construct(lua_State* L, bool is_unsigned)
+{
+    LasrInt64 value;
+    if (lua_type(L, 1) == LUA_TSTRING) {
+        const char* text = lua_tostring(L, 1);
+        char* end;
+        value.bits = is_unsigned ? strtoull(text, &end, 0) : (uint64_t)strtoll(text, &end, 0);
+        if (end == text || *end != '\0') {
+            printf("[%s] Invalid integer: %s\n", is_unsigned ? "uint64" : "int64", text);
+            lua_pushnil(L);
+            return 1;
+        }
+    } else if (!int64_check(L, 1, &value)) {
+        printf("[%s] The argument must be a number or a string\n", is_unsigned ? "uint64" : "int64");
+        lua_pushnil(L);
+        return 1;
+    }
+    int64_push(L, value.bits, is_unsigned);
+    return 1;
+}
+
+/**
+ * The "int64" Lua Auto Splitter Runtime function.
+ */
+static int int64_new(lua_State* L)
+{
+    return construct(L, false);
+}
+
+/**
+ * The "uint64" Lua Auto Splitter Runtime function.
+ */
+static int uint64_new(lua_State* L)
+{
+    return construct(L, true);
+}
+
+/**
+ * Creates the metatable of boxed integers and the int64/uint64 constructors.
+ *
+ * @param L The Lua state.
+ */
+void int64_register(lua_State* L)
+{
+    static const luaL_Reg metamethods[] = {
+        { "__add", int64_add },
+        { "__sub", int64_sub },
+        { "__mul", int64_mul },
+        { "__div", int64_div },
+        { "__mod", int64_mod },
+        { "__unm", int64_unm },
+        { "__eq", int64_eq },
+        { "__lt", int64_lt },
+        { "__le", int64_le },
+        { "__tostring", int64_tostring },
+        { NULL, NULL }
+    };
+    static const luaL_Reg methods[] = {
+        { "tonumber", int64_tonumber },
+        { "hex", int64_hex },
+        { NULL, NULL }
+    };
+
+    luaL_newmetatable(L, INT64_METATABLE);
+    luaL_register(L, NULL, metamethods);
+    lua_newtable(L);
+    luaL_register(L, NULL, methods);
+    lua_setfield(L, -2, "__index");
+    lua_pop(L, 1);
+
+    lua_pushcfunction(L, int64_new);
+    lua_setglobal(L, "int64");
+    lua_pushcfunction(L, uint64_new);
+    lua_setglobal(L, "uint64");
+}
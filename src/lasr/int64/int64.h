@@ -0,0 +1,21 @@
+#pragma once
+
+#include <lua.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define INT64_METATABLE "LASR.Int64"
+
+/**
+ * A 64 bit integer, boxed so it can be handed to Lua without going through a double.
+ */
+typedef struct LasrInt64 {
+    uint64_t bits; /*!< The value, as two's complement for signed integers */
+    bool is_unsigned; /*!< Whether the value is a uint64 */
+} LasrInt64;
+
+void int64_push(lua_State* L, uint64_t bits, bool is_unsigned);
+void int64_push_exact(lua_State* L, uint64_t bits, bool is_unsigned);
+bool int64_is_boxed(lua_State* L, int index);
+bool int64_check(lua_State* L, int index, LasrInt64* value);
+void int64_register(lua_State* L);
@@ -1,5 +1,7 @@
 #include "maps.h"
 
+#include "src/lasr/profiler/profiler.h"
+#include "src/lasr/replay/replay.h"
 #include "src/lasr/utils.h"
 
 #include <fcntl.h>
@@ -267,7 +269,24 @@ static size_t maps_getAll_init(void)
  */
 size_t maps_getAll(void)
 {
-    return (*maps_getAll_var)();
+    profiler_count_maps_rebuild();
+
+    if (replay_mode == REPLAY_REPLAYING) {
+        size_t count = 0;
+        ProcessMap* maps = replay_read_maps(&count);
+        if (maps) {
+            maps_clearCache();
+            maps_cache = maps;
+            maps_cache_size = count;
+        }
+        return maps_cache_size;
+    }
+
+    size_t count = (*maps_getAll_var)();
+    if (replay_mode == REPLAY_RECORDING) {
+        replay_record_maps(maps_cache, maps_cache_size);
+    }
+    return count;
 }
 
 /**
@@ -0,0 +1,293 @@
+/** \file memory.c
+ *
+ * Single entry point for every read of the game process memory
+ *
+ * The reads go through a backend picked when attaching to the game, since some systems
+ * deny process_vm_readv but allow reading /proc/<pid>/mem, or the other way around.
+ */
+#include "memory.h"
+
+#include "profiler/profiler.h"
+#include "replay/replay.h"
+#include "snapshot/snapshot.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROBE_SIZE 8 // Size of the reads used to benchmark the backends
+#define PROBE_READS 256 // Number of reads used to benchmark the backends
+
+/**
+ * Reads through process_vm_readv, one syscall per read without any state.
+ */
+static ssize_t vm_readv_read(uintptr_t address, void* buffer, size_t size)
+{
+    struct iovec local = { buffer, size };
+    struct iovec remote = { (void*)address, size };
+    return process_vm_readv(process.pid, &local, 1, &remote, 1, 0);
+}
+
+static bool vm_readv_open(pid_t pid)
+{
+    (void)pid;
+    return true;
+}
+
+static void vm_readv_close(void)
+{
+}
+
+static int proc_mem_fd = -1; /*!< The held /proc/<pid>/mem file */
+
+/**
+ * Reads through pread on /proc/<pid>/mem, kept open while attached.
+ */
+static ssize_t proc_mem_read(uintptr_t address, void* buffer, size_t size)
+{
+    if (address > INT64_MAX) {
+        errno = EFAULT;
+        return -1;
+    }
+    ssize_t n_read = pread(proc_mem_fd, buffer, size, (off_t)address);
+    if (n_read == -1 && errno == EIO) {
+        // Unmapped memory, reported as EFAULT like process_vm_readv does
+        errno = EFAULT;
+    }
+    return n_read;
+}
+
+static bool proc_mem_open(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/mem", (int)pid);
+    proc_mem_fd = open(path, O_RDONLY | O_CLOEXEC);
+    return proc_mem_fd != -1;
+}
+
+static void proc_mem_close(void)
+{
+    if (proc_mem_fd != -1) {
+        close(proc_mem_fd);
+        proc_mem_fd = -1;
+    }
+}
+
+/**
+ * Serves the reads from the recording being replayed.
+ */
+static ssize_t replay_backend_read(uintptr_t address, void* buffer, size_t size)
+{
+    return replay_read(address, buffer, size);
+}
+
+/**
+ * Reads many blocks with a single process_vm_readv call.
+ */
+static ssize_t vm_readv_read_vector(const struct iovec* local, const struct iovec* remote, int count)
+{
+    return process_vm_readv(process.pid, local, count, remote, count, 0);
+}
+
+static const MemoryBackend vm_readv_backend = {
+    "process_vm_readv", vm_readv_open, vm_readv_close, vm_readv_read, vm_readv_read_vector
+};
+static const MemoryBackend proc_mem_backend = {
+    "proc_mem", proc_mem_open, proc_mem_close, proc_mem_read, NULL
+};
+static const MemoryBackend replay_backend = {
+    "replay", vm_readv_open, vm_readv_close, replay_backend_read, NULL
+};
+
+/**
+ * The backends that can read from a live process, in order of preference.
+ */
+static const MemoryBackend* const backends[] = {
+    &vm_readv_backend,
+    &proc_mem_backend,
+};
+
+static const MemoryBackend* backend = &vm_readv_backend; /*!< The backend in use */
+
+/**
+ * Benchmarks a backend with small reads, like the ones done by readAddress.
+ *
+ * @param candidate The backend, already opened.
+ * @param address A readable address of the game.
+ *
+ * @return The time taken in nanoseconds, or -1 if the backend can't read the game memory.
+ */
+static long long benchmark_backend(const MemoryBackend* candidate, uintptr_t address)
+{
+    uint8_t buffer[PROBE_SIZE];
+    if (candidate->read(address, buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer)) {
+        return -1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < PROBE_READS; i++) {
+        candidate->read(address + (i % 8) * sizeof(buffer), buffer, sizeof(buffer));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+}
+
+/**
+ * Picks the backend used to read the memory of a newly attached game.
+ *
+ * Every backend able to read the given address is benchmarked and the fastest one is used.
+ * LIBRESPLIT_MEMORY_BACKEND can force one by name, falling back to the others if it
+ * can't read the game memory.
+ *
+ * @param pid The game process.
+ * @param probe_address A readable address of the game, like its base address.
+ */
+void memory_attach(pid_t pid, uintptr_t probe_address)
+{
+    memory_detach();
+
+    if (replay_mode == REPLAY_REPLAYING) {
+        backend = &replay_backend;
+        return;
+    }
+
+    const char* forced = getenv("LIBRESPLIT_MEMORY_BACKEND");
+    const MemoryBackend* best = NULL;
+    long long best_time = -1;
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        const MemoryBackend* candidate = backends[i];
+        if (!candidate->open(pid)) {
+            printf("[memory] %s backend unavailable: %s\n", candidate->name, strerror(errno));
+            continue;
+        }
+        long long time = benchmark_backend(candidate, probe_address);
+        candidate->close();
+        if (time < 0) {
+            printf("[memory] %s backend can't read the game memory\n", candidate->name);
+            continue;
+        }
+        printf("[memory] %s backend: %lld ns for %d reads\n", candidate->name, time, PROBE_READS);
+
+        if (forced && strcmp(forced, candidate->name) == 0) {
+            best = candidate;
+            break;
+        }
+        if (!best || time < best_time) {
+            best = candidate;
+            best_time = time;
+        }
+    }
+
+    if (!best) {
+        // Keep reading with the default one, its errors will tell the user what's wrong
+        best = &vm_readv_backend;
+    }
+    if (forced && strcmp(forced, best->name) != 0) {
+        printf("[memory] Can't use the %s backend, falling back to %s\n", forced, best->name);
+    }
+    if (!best->open(pid)) {
+        best = &vm_readv_backend;
+    }
+    backend = best;
+    printf("[memory] Using the %s backend\n", backend->name);
+}
+
+/**
+ * Releases the backend of the game the auto splitter was attached to.
+ */
+void memory_detach(void)
+{
+    backend->close();
+    backend = &vm_readv_backend;
+}
+
+/**
+ * Reads a block of memory from the game process, recording it if needed.
+ */
+static ssize_t read_recorded(uintptr_t address, void* buffer, size_t size)
+{
+    ssize_t n_read = read_process_memory_direct(address, buffer, size);
+    if (replay_mode == REPLAY_RECORDING) {
+        int err = errno;
+        replay_record_read(address, size, n_read, err, buffer);
+        errno = err;
+    }
+    return n_read;
+}
+
+/**
+ * Reads a block of memory from the game process.
+ *
+ * Reads inside a snapshot region are served from the copy taken at the start of the tick.
+ *
+ * @param address The address in the game process to read from.
+ * @param buffer The buffer to read into, at least size bytes long.
+ * @param size The number of bytes to read.
+ *
+ * @return The number of bytes read, or -1 with errno set on error.
+ */
+ssize_t read_process_memory(uintptr_t address, void* buffer, size_t size)
+{
+    if (snapshot_lookup(address, buffer, size)) {
+        return size;
+    }
+    return read_recorded(address, buffer, size);
+}
+
+/**
+ * Reads many blocks of memory from the game process at once, like process_vm_readv.
+ *
+ * The blocks are read in order and the reading stops at the first one that fails.
+ * Backends without vectored reads, recordings and replays read them one by one.
+ *
+ * @param local The buffers to read into.
+ * @param remote The blocks to read, each one the same size as its buffer.
+ * @param count The number of blocks.
+ *
+ * @return The total number of bytes read, or -1 with errno set if the first block failed.
+ */
+ssize_t read_process_memory_vector(const struct iovec* local, const struct iovec* remote, int count)
+{
+    if (backend->read_vector && replay_mode == REPLAY_OFF) {
+        ssize_t n_read = backend->read_vector(local, remote, count);
+        profiler_count_read(n_read > 0 ? (size_t)n_read : 0);
+        return n_read;
+    }
+
+    ssize_t total = 0;
+    for (int i = 0; i < count; i++) {
+        ssize_t n_read = read_recorded((uintptr_t)remote[i].iov_base, local[i].iov_base, local[i].iov_len);
+        if (n_read == -1) {
+            return i == 0 ? -1 : total;
+        }
+        total += n_read;
+        if ((size_t)n_read != local[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+/**
+ * Reads a block of memory from the game process, bypassing the recording.
+ *
+ * Meant for reads whose result is recorded at a higher level, like signature scans.
+ *
+ * @param address The address in the game process to read from.
+ * @param buffer The buffer to read into, at least size bytes long.
+ * @param size The number of bytes to read.
+ *
+ * @return The number of bytes read, or -1 with errno set on error.
+ */
+ssize_t read_process_memory_direct(uintptr_t address, void* buffer, size_t size)
+{
+    ssize_t n_read = backend->read(address, buffer, size);
+    profiler_count_read(n_read > 0 ? (size_t)n_read : 0);
+    return n_read;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * A way of reading the memory of the game process.
+ */
+typedef struct MemoryBackend {
+    const char* name; /*!< The name, as accepted by LIBRESPLIT_MEMORY_BACKEND */
+    bool (*open)(pid_t pid); /*!< Prepares to read from a process, false if unavailable */
+    void (*close)(void); /*!< Releases what open acquired */
+    ssize_t (*read)(uintptr_t address, void* buffer, size_t size); /*!< Reads like process_vm_readv */
+    ssize_t (*read_vector)(const struct iovec* local, const struct iovec* remote, int count); /*!< Optional vectored read */
+} MemoryBackend;
+
+void memory_attach(pid_t pid, uintptr_t probe_address);
+void memory_detach(void);
+ssize_t read_process_memory(uintptr_t address, void* buffer, size_t size);
+ssize_t read_process_memory_vector(const struct iovec* local, const struct iovec* remote, int count);
+ssize_t read_process_memory_direct(uintptr_t address, void* buffer, size_t size);
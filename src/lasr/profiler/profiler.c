@@ -0,0 +1,186 @@
+#include "profiler.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Written by the auto splitter thread, read when a dump is requested from the main thread
+static pthread_mutex_t profiler_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static ProfilerHistogram sections[PROFILE_SECTION_COUNT]; // Time spent in each section, in microseconds
+static ProfilerHistogram tick_syscalls; // Memory reads done in each tick
+static ProfilerHistogram tick_bytes; // Bytes read in each tick
+static uint64_t maps_rebuilds = 0; // Times the maps cache was rebuilt
+
+// Atomic since background signature scans read memory too
+static _Atomic uint64_t current_syscalls = 0; // Memory reads done in the current tick
+static _Atomic uint64_t current_bytes = 0; // Bytes read in the current tick
+
+static const char* section_names[PROFILE_SECTION_COUNT] = {
+    "state",
+    "update",
+    "gameTime",
+    "start",
+    "split",
+    "isLoading",
+    "reset",
+    "sig_scan",
+    "gc",
+    "tick",
+};
+
+/**
+ * Adds a sample to a histogram.
+ *
+ * @param histogram The histogram.
+ * @param value The sample.
+ */
+static void histogram_add(ProfilerHistogram* histogram, uint64_t value)
+{
+    int bucket = 0;
+    while (bucket < PROFILER_BUCKETS - 1 && (value >> bucket) > 1) {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    histogram->window[histogram->count % PROFILER_WINDOW] = value;
+    histogram->count++;
+    histogram->total += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+static int compare_samples(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Prints a histogram on a single line, with percentiles over the recent samples.
+ *
+ * @param out The stream to print to.
+ * @param name The name of the histogram.
+ * @param histogram The histogram.
+ */
+static void histogram_dump(FILE* out, const char* name, const ProfilerHistogram* histogram)
+{
+    if (histogram->count == 0) {
+        return;
+    }
+
+    uint64_t sorted[PROFILER_WINDOW];
+    size_t samples = histogram->count < PROFILER_WINDOW ? histogram->count : PROFILER_WINDOW;
+    memcpy(sorted, histogram->window, samples * sizeof(uint64_t));
+    qsort(sorted, samples, sizeof(uint64_t), compare_samples);
+
+    fprintf(out, "  %-10s n=%-8llu avg=%-8.1f p50=%-8llu p99=%-8llu max=%llu\n",
+        name,
+        (unsigned long long)histogram->count,
+        (double)histogram->total / histogram->count,
+        (unsigned long long)sorted[samples / 2],
+        (unsigned long long)sorted[samples * 99 / 100],
+        (unsigned long long)histogram->max);
+
+    fprintf(out, "  %-10s", "");
+    for (int i = 0; i < PROFILER_BUCKETS; i++) {
+        if (histogram->buckets[i]) {
+            fprintf(out, " <%llu:%llu", 2ULL << i, (unsigned long long)histogram->buckets[i]);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * Clears all the collected samples.
+ *
+ * Called when an auto splitter starts running.
+ */
+void profiler_reset(void)
+{
+    pthread_mutex_lock(&profiler_mutex);
+    memset(sections, 0, sizeof(sections));
+    memset(&tick_syscalls, 0, sizeof(tick_syscalls));
+    memset(&tick_bytes, 0, sizeof(tick_bytes));
+    maps_rebuilds = 0;
+    current_syscalls = 0;
+    current_bytes = 0;
+    pthread_mutex_unlock(&profiler_mutex);
+}
+
+/**
+ * Records the time spent in a section of the tick.
+ *
+ * @param section The section.
+ * @param us The time spent, in microseconds.
+ */
+void profiler_record(ProfilerSection section, uint64_t us)
+{
+    pthread_mutex_lock(&profiler_mutex);
+    histogram_add(&sections[section], us);
+    pthread_mutex_unlock(&profiler_mutex);
+}
+
+/**
+ * Counts a read of the game process memory in the current tick.
+ *
+ * Called from both the auto splitter thread and the sig_scan_async thread, the counters
+ * are atomic so no locking is needed. Reads of a scan count in the tick they happen in.
+ *
+ * @param bytes The number of bytes read.
+ */
+void profiler_count_read(size_t bytes)
+{
+    current_syscalls++;
+    current_bytes += bytes;
+}
+
+/**
+ * Counts a rebuild of the memory maps cache.
+ */
+void profiler_count_maps_rebuild(void)
+{
+    pthread_mutex_lock(&profiler_mutex);
+    maps_rebuilds++;
+    pthread_mutex_unlock(&profiler_mutex);
+}
+
+/**
+ * Closes the current tick, adding its time and memory reads to the histograms.
+ *
+ * @param us The duration of the tick, in microseconds.
+ */
+void profiler_tick_end(uint64_t us)
+{
+    // Taken and cleared at once, so reads counted meanwhile by the scan thread aren't lost
+    uint64_t syscalls = atomic_exchange(&current_syscalls, 0);
+    uint64_t bytes = atomic_exchange(&current_bytes, 0);
+
+    pthread_mutex_lock(&profiler_mutex);
+    histogram_add(&sections[PROFILE_TICK], us);
+    histogram_add(&tick_syscalls, syscalls);
+    histogram_add(&tick_bytes, bytes);
+    pthread_mutex_unlock(&profiler_mutex);
+}
+
+/**
+ * Prints the collected samples.
+ *
+ * @param out The stream to print to.
+ */
+void profiler_dump(FILE* out)
+{
+    pthread_mutex_lock(&profiler_mutex);
+    fprintf(out, "Auto splitter profile (times in microseconds, percentiles over the last %d samples)\n", PROFILER_WINDOW);
+    for (int i = 0; i < PROFILE_SECTION_COUNT; i++) {
+        histogram_dump(out, section_names[i], &sections[i]);
+    }
+    fprintf(out, "Per tick:\n");
+    histogram_dump(out, "reads", &tick_syscalls);
+    histogram_dump(out, "bytes", &tick_bytes);
+    fprintf(out, "Maps cache rebuilds: %llu\n", (unsigned long long)maps_rebuilds);
+    pthread_mutex_unlock(&profiler_mutex);
+    fflush(out);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PROFILER_BUCKETS 24 // log2 buckets, the last one holds everything above ~8s
+#define PROFILER_WINDOW 256 // Samples kept for the rolling percentiles
+
+/**
+ * The parts of an auto splitter tick that are timed separately.
+ */
+typedef enum ProfilerSection {
+    PROFILE_STATE,
+    PROFILE_UPDATE,
+    PROFILE_GAME_TIME,
+    PROFILE_START,
+    PROFILE_SPLIT,
+    PROFILE_IS_LOADING,
+    PROFILE_RESET,
+    PROFILE_SIG_SCAN,
+    PROFILE_GC,
+    PROFILE_TICK,
+    PROFILE_SECTION_COUNT,
+} ProfilerSection;
+
+/**
+ * Aggregated samples of a section or of a per-tick counter.
+ */
+typedef struct ProfilerHistogram {
+    uint64_t count; /*!< Number of samples */
+    uint64_t total; /*!< Sum of all the samples */
+    uint64_t max; /*!< Biggest sample */
+    uint64_t buckets[PROFILER_BUCKETS]; /*!< Samples counted by their power of two */
+    uint64_t window[PROFILER_WINDOW]; /*!< The most recent samples */
+} ProfilerHistogram;
+
+void profiler_reset(void);
+void profiler_record(ProfilerSection section, uint64_t us);
+void profiler_count_read(size_t bytes);
+void profiler_count_maps_rebuild(void);
+void profiler_tick_end(uint64_t us);
+void profiler_dump(FILE* out);
@@ -0,0 +1,349 @@
+#include "replay.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+ReplayMode replay_mode = REPLAY_OFF;
+
+// The recording is a flat sequence of records, each one starting with a tag byte.
+// During replay every record is consumed in the same order it was written in,
+// so the auto splitter has to ask for the same reads it asked for when recording.
+#define RECORD_PID 'P'
+#define RECORD_TICK 'T'
+#define RECORD_READ 'R'
+#define RECORD_MAPS 'M'
+#define RECORD_SIG_SCAN 'S'
+
+typedef struct __attribute__((__packed__)) ReplayRead {
+    uint64_t address; /*!< The address that was read */
+    uint32_t size; /*!< The requested size */
+    int32_t result; /*!< Bytes read, followed in the file by the bytes themselves, or -errno */
+} ReplayRead;
+
+typedef struct __attribute__((__packed__)) ReplayMap {
+    uint64_t start; /*!< Start address of the map */
+    uint64_t end; /*!< End address of the map */
+    uint16_t name_length; /*!< Length of the name following in the file */
+} ReplayMap;
+
+typedef struct __attribute__((__packed__)) ReplaySigScan {
+    uint8_t found; /*!< Non-zero if the signature was found */
+    int64_t result; /*!< The value returned to Lua */
+} ReplaySigScan;
+
+static FILE* replay_file = NULL; // The recording being written or read
+static bool replay_done = false; // The replay reached the end of the recording or diverged from it
+static uint64_t replay_ticks = 0; // Ticks recorded or replayed
+static uint64_t replay_reads = 0; // Memory reads recorded or replayed
+static struct timespec replay_start; // When the recording or the replay started
+
+/**
+ * Opens the recording requested through the environment, if any.
+ *
+ * LIBRESPLIT_LASR_REPLAY takes precedence over LIBRESPLIT_LASR_RECORD.
+ */
+void replay_open(void)
+{
+    const char* replay_path = getenv("LIBRESPLIT_LASR_REPLAY");
+    const char* record_path = getenv("LIBRESPLIT_LASR_RECORD");
+
+    replay_close();
+    replay_done = false;
+    replay_ticks = 0;
+    replay_reads = 0;
+    clock_gettime(CLOCK_MONOTONIC, &replay_start);
+
+    if (replay_path) {
+        replay_file = fopen(replay_path, "rb");
+        if (!replay_file) {
+            perror("Failed to open the auto splitter recording");
+            return;
+        }
+        char magic[4];
+        uint32_t version;
+        if (fread(magic, sizeof(magic), 1, replay_file) != 1 || memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0
+            || fread(&version, sizeof(version), 1, replay_file) != 1 || version != REPLAY_VERSION) {
+            fprintf(stderr, "%s is not a supported auto splitter recording\n", replay_path);
+            fclose(replay_file);
+            replay_file = NULL;
+            return;
+        }
+        replay_mode = REPLAY_REPLAYING;
+        printf("Replaying auto splitter memory reads from %s\n", replay_path);
+    } else if (record_path) {
+        replay_file = fopen(record_path, "wb");
+        if (!replay_file) {
+            perror("Failed to create the auto splitter recording");
+            return;
+        }
+        uint32_t version = REPLAY_VERSION;
+        fwrite(REPLAY_MAGIC, 4, 1, replay_file);
+        fwrite(&version, sizeof(version), 1, replay_file);
+        replay_mode = REPLAY_RECORDING;
+        printf("Recording auto splitter memory reads to %s\n", record_path);
+    }
+}
+
+/**
+ * Closes the recording, printing a summary of the replay.
+ */
+void replay_close(void)
+{
+    if (!replay_file) {
+        return;
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed_ms = (end.tv_sec - replay_start.tv_sec) * 1000.0 + (end.tv_nsec - replay_start.tv_nsec) / 1000000.0;
+    printf("%s %llu ticks and %llu memory reads in %.1fms\n",
+        replay_mode == REPLAY_REPLAYING ? "Replayed" : "Recorded",
+        (unsigned long long)replay_ticks,
+        (unsigned long long)replay_reads,
+        elapsed_ms);
+
+    fclose(replay_file);
+    replay_file = NULL;
+    replay_mode = REPLAY_OFF;
+}
+
+/**
+ * Checks if the replay can't serve any more reads.
+ *
+ * @return True if replaying and the recording is over or the replay diverged.
+ */
+bool replay_finished(void)
+{
+    return replay_mode == REPLAY_REPLAYING && replay_done;
+}
+
+/**
+ * Consumes the next record of the recording, which must have the given tag.
+ *
+ * @param tag The expected record tag.
+ *
+ * @return True if the next record has the expected tag.
+ */
+static bool replay_expect(char tag)
+{
+    if (replay_done) {
+        return false;
+    }
+
+    int found = fgetc(replay_file);
+    if (found == EOF) {
+        printf("End of the auto splitter recording reached\n");
+        replay_done = true;
+        return false;
+    }
+    if (found != tag) {
+        fprintf(stderr, "Replay diverged from the recording at tick %llu: expected a '%c' record, found '%c'\n",
+            (unsigned long long)replay_ticks, tag, found);
+        replay_done = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Marks the start of a new auto splitter tick.
+ *
+ * @return False if replaying and the recording has no more ticks.
+ */
+bool replay_tick(void)
+{
+    if (replay_mode == REPLAY_RECORDING) {
+        fputc(RECORD_TICK, replay_file);
+    } else if (replay_mode == REPLAY_REPLAYING && !replay_expect(RECORD_TICK)) {
+        return false;
+    }
+    replay_ticks++;
+    return true;
+}
+
+/**
+ * Records the PID of the process the auto splitter attached to.
+ *
+ * @param pid The process ID.
+ */
+void replay_record_pid(unsigned int pid)
+{
+    uint32_t value = pid;
+    fputc(RECORD_PID, replay_file);
+    fwrite(&value, sizeof(value), 1, replay_file);
+}
+
+/**
+ * Reads the PID of the process the auto splitter was attached to.
+ *
+ * @param pid Where to store the process ID.
+ *
+ * @return True if the PID was read.
+ */
+bool replay_read_pid(unsigned int* pid)
+{
+    uint32_t value;
+    if (!replay_expect(RECORD_PID) || fread(&value, sizeof(value), 1, replay_file) != 1) {
+        replay_done = true;
+        return false;
+    }
+    *pid = value;
+    return true;
+}
+
+/**
+ * Records a read of the game process memory.
+ *
+ * @param address The address that was read.
+ * @param size The requested size.
+ * @param result The number of bytes read, or -1 on error.
+ * @param err The errno value of the read, if it failed.
+ * @param buffer The bytes read.
+ */
+void replay_record_read(uintptr_t address, size_t size, ssize_t result, int err, const void* buffer)
+{
+    ReplayRead read = {
+        .address = address,
+        .size = size,
+        .result = result < 0 ? -err : (int32_t)result,
+    };
+    fputc(RECORD_READ, replay_file);
+    fwrite(&read, sizeof(read), 1, replay_file);
+    if (result > 0) {
+        fwrite(buffer, result, 1, replay_file);
+    }
+    replay_reads++;
+}
+
+/**
+ * Serves a read of the game process memory from the recording.
+ *
+ * @param address The address to read from.
+ * @param buffer The buffer to read into.
+ * @param size The number of bytes to read.
+ *
+ * @return The number of bytes read, or -1 with errno set on error.
+ */
+ssize_t replay_read(uintptr_t address, void* buffer, size_t size)
+{
+    ReplayRead read;
+    if (!replay_expect(RECORD_READ) || fread(&read, sizeof(read), 1, replay_file) != 1) {
+        replay_done = true;
+        errno = ESRCH;
+        return -1;
+    }
+    if (read.address != address || read.size != size) {
+        fprintf(stderr, "Replay diverged from the recording at tick %llu: read of %zu bytes at 0x%" PRIxPTR ", recorded %u bytes at 0x%llx\n",
+            (unsigned long long)replay_ticks, size, address, read.size, (unsigned long long)read.address);
+        replay_done = true;
+        errno = ESRCH;
+        return -1;
+    }
+    replay_reads++;
+    if (read.result < 0) {
+        errno = -read.result;
+        return -1;
+    }
+    if (read.result > 0 && fread(buffer, read.result, 1, replay_file) != 1) {
+        replay_done = true;
+        errno = ESRCH;
+        return -1;
+    }
+    return read.result;
+}
+
+/**
+ * Records a snapshot of the game process memory maps.
+ *
+ * @param maps The maps.
+ * @param count The number of maps.
+ */
+void replay_record_maps(const ProcessMap* maps, size_t count)
+{
+    uint32_t value = count;
+    fputc(RECORD_MAPS, replay_file);
+    fwrite(&value, sizeof(value), 1, replay_file);
+    for (size_t i = 0; i < count; i++) {
+        ReplayMap map = {
+            .start = maps[i].start,
+            .end = maps[i].end,
+            .name_length = strnlen(maps[i].name, sizeof(maps[i].name)),
+        };
+        fwrite(&map, sizeof(map), 1, replay_file);
+        fwrite(maps[i].name, map.name_length, 1, replay_file);
+    }
+}
+
+/**
+ * Reads a snapshot of the game process memory maps.
+ *
+ * @param count Where to store the number of maps.
+ *
+ * @return A malloc'd array of maps, or NULL if the recording has no maps here.
+ */
+ProcessMap* replay_read_maps(size_t* count)
+{
+    uint32_t value;
+    if (!replay_expect(RECORD_MAPS) || fread(&value, sizeof(value), 1, replay_file) != 1) {
+        replay_done = true;
+        return NULL;
+    }
+
+    ProcessMap* maps = calloc(value ? value : 1, sizeof(ProcessMap));
+    if (!maps) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < value; i++) {
+        ReplayMap map;
+        if (fread(&map, sizeof(map), 1, replay_file) != 1 || map.name_length >= sizeof(maps[i].name)
+            || (map.name_length && fread(maps[i].name, map.name_length, 1, replay_file) != 1)) {
+            free(maps);
+            replay_done = true;
+            return NULL;
+        }
+        maps[i].start = map.start;
+        maps[i].end = map.end;
+        maps[i].size = map.end - map.start;
+    }
+    *count = value;
+    return maps;
+}
+
+/**
+ * Records the outcome of a signature scan.
+ *
+ * The memory read by the scan is not recorded, only its result.
+ *
+ * @param found True if the signature was found.
+ * @param result The value returned to Lua.
+ */
+void replay_record_sig_scan(bool found, intptr_t result)
+{
+    ReplaySigScan scan = { .found = found, .result = result };
+    fputc(RECORD_SIG_SCAN, replay_file);
+    fwrite(&scan, sizeof(scan), 1, replay_file);
+}
+
+/**
+ * Reads the outcome of a signature scan.
+ *
+ * @param found Where to store whether the signature was found.
+ * @param result Where to store the value returned to Lua.
+ *
+ * @return True if the outcome was read.
+ */
+bool replay_read_sig_scan(bool* found, intptr_t* result)
+{
+    ReplaySigScan scan;
+    if (!replay_expect(RECORD_SIG_SCAN) || fread(&scan, sizeof(scan), 1, replay_file) != 1) {
+        replay_done = true;
+        return false;
+    }
+    *found = scan.found;
+    *result = scan.result;
+    return true;
+}
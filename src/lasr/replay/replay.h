@@ -0,0 +1,39 @@
+#pragma once
+
+#include "src/lasr/utils.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define REPLAY_MAGIC "LSRR"
+#define REPLAY_VERSION 1
+
+/**
+ * What the auto splitter does with its memory reads.
+ */
+typedef enum ReplayMode {
+    REPLAY_OFF, /*!< Reads come from the game process */
+    REPLAY_RECORDING, /*!< Reads come from the game process and are written to the recording */
+    REPLAY_REPLAYING, /*!< Reads come from the recording, the game is not needed */
+} ReplayMode;
+
+extern ReplayMode replay_mode;
+
+void replay_open(void);
+void replay_close(void);
+bool replay_finished(void);
+bool replay_tick(void);
+
+void replay_record_pid(unsigned int pid);
+bool replay_read_pid(unsigned int* pid);
+
+void replay_record_read(uintptr_t address, size_t size, ssize_t result, int err, const void* buffer);
+ssize_t replay_read(uintptr_t address, void* buffer, size_t size);
+
+void replay_record_maps(const ProcessMap* maps, size_t count);
+ProcessMap* replay_read_maps(size_t* count);
+
+void replay_record_sig_scan(bool found, intptr_t result);
+bool replay_read_sig_scan(bool* found, intptr_t* result);
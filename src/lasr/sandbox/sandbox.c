@@ -0,0 +1,470 @@
+/** \file sandbox.c
+ *
+ * Runs the auto splitter in a separate host process
+ *
+ * LibreSplit starts itself again with LASR_HOST_ARG, and the new process runs the auto
+ * splitter as usual. On both sides a bridge moves the requests the auto splitter makes
+ * through the call_start, call_split, ... atomics over shared memory, so neither the
+ * auto splitter nor the timer know they are in different processes. If the host crashes
+ * it's started again, and it picks up the state of the run from the shared memory.
+ */
+#define _GNU_SOURCE // memfd_create
+
+#include "sandbox.h"
+
+#include "../auto-splitter.h"
+#include "../utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HOST_SHARED_FD 3 // Where the host finds the shared memory
+#define STOP_INTERVAL_US 1000 // How often the host is checked while it stops
+#define RESTART_DELAY_MIN_MS 100
+#define RESTART_DELAY_MAX_MS 5000
+#define STOP_TIMEOUT_MS 1000 // Time given to the host to exit before killing it
+
+extern char** environ;
+extern atomic_bool exit_requested;
+
+atomic_bool auto_splitter_sandboxed = false; /*!< Run the auto splitter in a host process */
+
+static atomic_bool permission_error = false; /*!< A memory read was denied in the host */
+
+/**
+ * Gets the current time in milliseconds.
+ */
+static long long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Sleeps until a futex word of the shared memory changes.
+ *
+ * @param word The futex word.
+ * @param expected The value read before checking for work, returns right away if it changed since.
+ * @param timeout_us The longest time to sleep, negative to sleep until woken.
+ */
+static void futex_wait(atomic_uint* word, unsigned expected, long long timeout_us)
+{
+    struct timespec timeout = { timeout_us / 1000000, (timeout_us % 1000000) * 1000 };
+    // Not FUTEX_PRIVATE_FLAG, the word is shared between the processes
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, timeout_us < 0 ? NULL : &timeout, NULL, 0);
+}
+
+/**
+ * Wakes the side sleeping on a futex word of the shared memory.
+ */
+static void futex_wake(atomic_uint* word)
+{
+    atomic_fetch_add(word, 1);
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * Queues an event for LibreSplit, on the host side.
+ *
+ * @return False if the ring is full, the event should be sent again later.
+ */
+static bool ring_push(LasrShared* shared, LasrEventType type, long long value)
+{
+    unsigned head = atomic_load_explicit(&shared->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&shared->tail, memory_order_acquire);
+    if (head - tail == LASR_RING_SIZE) {
+        return false;
+    }
+    shared->events[head % LASR_RING_SIZE] = (LasrEvent) { type, value };
+    atomic_store_explicit(&shared->head, head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Takes the next event sent by the host, on the LibreSplit side.
+ *
+ * @return False if there are no events.
+ */
+static bool ring_pop(LasrShared* shared, LasrEvent* event)
+{
+    unsigned tail = atomic_load_explicit(&shared->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&shared->head, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *event = shared->events[tail % LASR_RING_SIZE];
+    atomic_store_explicit(&shared->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Sends the request behind a flag set by the auto splitter, clearing the flag once sent.
+ *
+ * @return True if the request was sent.
+ */
+static bool forward_flag(LasrShared* shared, atomic_bool* flag, LasrEventType type, long long value)
+{
+    if (atomic_load(flag) && ring_push(shared, type, value)) {
+        atomic_store(flag, false);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Sends the pending requests of the auto splitter to LibreSplit, on the host side.
+ *
+ * Requests that don't fit in the ring stay pending, LibreSplit wakes the bridge up once
+ * it has read the ring.
+ */
+static void host_send_events(LasrShared* shared)
+{
+    bool sent = forward_flag(shared, &call_start, LASR_EVENT_START, 0);
+    sent |= forward_flag(shared, &call_split, LASR_EVENT_SPLIT, 0);
+    sent |= forward_flag(shared, &toggle_loading, LASR_EVENT_TOGGLE_LOADING, 0);
+    sent |= forward_flag(shared, &call_reset, LASR_EVENT_RESET, 0);
+    sent |= forward_flag(shared, &update_game_time, LASR_EVENT_GAME_TIME, atomic_load(&game_time_value));
+    sent |= forward_flag(shared, &permission_error, LASR_EVENT_PERMISSION_ERROR, 0);
+    if (sent) {
+        futex_wake(&shared->main_wake);
+    }
+}
+
+/**
+ * Applies the run state published by LibreSplit, on the host side.
+ *
+ * @param shared The shared memory.
+ * @param generation The last generation applied, updated.
+ */
+static void host_apply_state(LasrShared* shared, unsigned* generation)
+{
+    unsigned current = atomic_load(&shared->generation);
+    if (current != *generation) {
+        *generation = current;
+        atomic_store(&run_started, atomic_load(&shared->run_started));
+        atomic_store(&run_finished, atomic_load(&shared->run_finished));
+    }
+    if (!atomic_load(&shared->enabled)) {
+        atomic_store(&auto_splitter_enabled, false);
+    }
+}
+
+static atomic_bool bridge_stop = false; /*!< Stops the host bridge */
+static LasrShared* host_shared = NULL; /*!< The shared memory, on the host side */
+
+/**
+ * Wakes the host bridge up when the auto splitter makes a request.
+ */
+static void host_notify(void)
+{
+    futex_wake(&host_shared->host_wake);
+}
+
+/**
+ * Asks LibreSplit to show the memory permission dialog, as the host can't show it.
+ */
+static void host_permission_error(void)
+{
+    atomic_store(&permission_error, true);
+    host_notify();
+}
+
+/**
+ * The bridge of the host, moving requests and state between the auto splitter and
+ * the shared memory.
+ *
+ * Sleeps until the auto splitter makes a request or LibreSplit changes the state.
+ */
+static void* host_bridge(void* arg)
+{
+    LasrShared* shared = arg;
+    unsigned generation = atomic_load(&shared->generation);
+    while (!atomic_load(&bridge_stop)) {
+        unsigned wake = atomic_load(&shared->host_wake);
+        host_send_events(shared);
+        host_apply_state(shared, &generation);
+        atomic_store(&shared->refresh_rate, refresh_rate);
+        futex_wait(&shared->host_wake, wake, -1);
+    }
+    host_send_events(shared);
+    return NULL;
+}
+
+/**
+ * Entry point of the auto splitter host process.
+ *
+ * Expects the auto splitter path as the argument after LASR_HOST_ARG, and the shared
+ * memory at HOST_SHARED_FD.
+ *
+ * @return The exit code, zero if the auto splitter was stopped normally.
+ */
+int lasr_host_main(int argc, char* argv[])
+{
+    // Don't keep anything LibreSplit forgot to mark as close on exec
+    long max_fd = sysconf(_SC_OPEN_MAX);
+    for (int fd = HOST_SHARED_FD + 1; fd < max_fd && fd < 65536; fd++) {
+        close(fd);
+    }
+
+    // Die with LibreSplit, and never gain privileges through exec
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() == 1) {
+        return 1;
+    }
+    prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
+    prctl(PR_SET_NAME, "LS LASR host", 0, 0, 0);
+
+    if (argc < 3 || strlen(argv[2]) >= PATH_MAX) {
+        fprintf(stderr, "[sandbox] Usage: %s %s <auto splitter>\n", argv[0], LASR_HOST_ARG);
+        return 1;
+    }
+
+    LasrShared* shared = mmap(NULL, sizeof(LasrShared), PROT_READ | PROT_WRITE, MAP_SHARED, HOST_SHARED_FD, 0);
+    if (shared == MAP_FAILED) {
+        perror("[sandbox] Failed to map the shared memory");
+        return 1;
+    }
+    close(HOST_SHARED_FD);
+
+    strcpy(auto_splitter_file, argv[2]);
+    prev_is_loading = atomic_load(&shared->loading);
+    atomic_store(&run_started, atomic_load(&shared->run_started));
+    atomic_store(&run_finished, atomic_load(&shared->run_finished));
+    atomic_store(&auto_splitter_enabled, atomic_load(&shared->enabled));
+
+    host_shared = shared;
+    auto_splitter_set_notify(host_notify);
+    set_permission_error_handler(host_permission_error);
+    pthread_t bridge;
+    if (pthread_create(&bridge, NULL, host_bridge, shared) != 0) {
+        perror("[sandbox] Failed to start the bridge");
+        return 1;
+    }
+
+    // Same as the auto splitter thread of LibreSplit
+    while (atomic_load(&auto_splitter_enabled)) {
+        run_auto_splitter();
+        usleep(50000);
+    }
+
+    atomic_store(&bridge_stop, true);
+    futex_wake(&shared->host_wake);
+    pthread_join(bridge, NULL);
+    return 0;
+}
+
+/**
+ * Starts the auto splitter host process.
+ *
+ * @param shared_fd The shared memory file descriptor.
+ * @param path The auto splitter to run.
+ *
+ * @return The host pid, or -1 on error.
+ */
+static pid_t spawn_host(int shared_fd, const char* path)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, shared_fd, HOST_SHARED_FD);
+
+    char* const argv[] = { "/proc/self/exe", LASR_HOST_ARG, (char*)path, NULL };
+    pid_t pid;
+    int err = posix_spawn(&pid, "/proc/self/exe", &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0) {
+        fprintf(stderr, "[sandbox] Failed to start the auto splitter host: %s\n", strerror(err));
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * Stops the host, killing it if it doesn't exit in time.
+ */
+static void stop_host(LasrShared* shared, pid_t pid)
+{
+    atomic_store(&shared->enabled, false);
+    futex_wake(&shared->host_wake);
+    long long deadline = now_ms() + STOP_TIMEOUT_MS;
+    while (waitpid(pid, NULL, WNOHANG) == 0) {
+        if (now_ms() > deadline) {
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            return;
+        }
+        usleep(STOP_INTERVAL_US);
+    }
+}
+
+/**
+ * Hands the requests sent by the host to the timer, through the same atomics the
+ * auto splitter thread uses.
+ */
+static void receive_events(LasrShared* shared)
+{
+    LasrEvent event;
+    bool received = false;
+    while (ring_pop(shared, &event)) {
+        received = true;
+        switch (event.type) {
+            case LASR_EVENT_START:
+                atomic_store(&run_started, true);
+                atomic_store(&call_start, true);
+                break;
+            case LASR_EVENT_SPLIT:
+                atomic_store(&call_split, true);
+                break;
+            case LASR_EVENT_TOGGLE_LOADING:
+                atomic_store(&shared->loading, !atomic_load(&shared->loading));
+                atomic_store(&toggle_loading, true);
+                break;
+            case LASR_EVENT_RESET:
+                atomic_store(&call_reset, true);
+                break;
+            case LASR_EVENT_GAME_TIME:
+                atomic_store(&game_time_value, event.value);
+                atomic_store(&update_game_time, true);
+                break;
+            case LASR_EVENT_PERMISSION_ERROR:
+                show_permission_error_dialog();
+                break;
+        }
+    }
+    if (received) {
+        auto_splitter_notify();
+        // Requests may be waiting for room in the ring
+        futex_wake(&shared->host_wake);
+    }
+}
+
+/**
+ * Publishes the run state to the host when the timer changes it.
+ */
+static void publish_state(LasrShared* shared)
+{
+    bool started = atomic_load(&run_started);
+    bool finished = atomic_load(&run_finished);
+    if (started != atomic_load(&shared->run_started) || finished != atomic_load(&shared->run_finished)) {
+        atomic_store(&shared->run_started, started);
+        atomic_store(&shared->run_finished, finished);
+        atomic_fetch_add(&shared->generation, 1);
+        futex_wake(&shared->host_wake);
+    }
+}
+
+/**
+ * Gets how long LibreSplit sleeps without events, one tick of the auto splitter.
+ *
+ * The state of the timer and the host process are checked at least that often.
+ */
+static long long state_interval_us(LasrShared* shared)
+{
+    int rate = atomic_load(&shared->refresh_rate);
+    return 1000000 / (rate > 0 ? rate : 60);
+}
+
+/**
+ * Runs the auto splitter in a host process, restarting it if it crashes.
+ *
+ * Returns when the auto splitter is disabled or changed, or when the host exits by itself.
+ */
+void run_auto_splitter_sandboxed()
+{
+    char current_file[PATH_MAX];
+    strcpy(current_file, auto_splitter_file);
+
+    int shared_fd = memfd_create("libresplit-lasr", MFD_CLOEXEC);
+    if (shared_fd == HOST_SHARED_FD) {
+        // Duplicating it onto itself would keep it close on exec
+        shared_fd = fcntl(HOST_SHARED_FD, F_DUPFD_CLOEXEC, HOST_SHARED_FD + 1);
+        close(HOST_SHARED_FD);
+    }
+    if (shared_fd == -1 || ftruncate(shared_fd, sizeof(LasrShared)) == -1) {
+        perror("[sandbox] Failed to create the shared memory");
+        if (shared_fd != -1) {
+            close(shared_fd);
+        }
+        atomic_store(&auto_splitter_enabled, false);
+        return;
+    }
+    LasrShared* shared = mmap(NULL, sizeof(LasrShared), PROT_READ | PROT_WRITE, MAP_SHARED, shared_fd, 0);
+    if (shared == MAP_FAILED) {
+        perror("[sandbox] Failed to map the shared memory");
+        close(shared_fd);
+        atomic_store(&auto_splitter_enabled, false);
+        return;
+    }
+
+    // The memfd is zeroed, only the state needs to be filled in
+    atomic_store(&shared->run_started, atomic_load(&run_started));
+    atomic_store(&shared->run_finished, atomic_load(&run_finished));
+    atomic_store(&shared->loading, prev_is_loading);
+    atomic_store(&shared->enabled, true);
+
+    int restart_delay = RESTART_DELAY_MIN_MS;
+    pid_t pid = spawn_host(shared_fd, current_file);
+    long long started_at = now_ms();
+    while (pid != -1) {
+        unsigned wake = atomic_load(&shared->main_wake);
+        if (!atomic_load(&auto_splitter_enabled) || atomic_load(&exit_requested) || strcmp(current_file, auto_splitter_file) != 0) {
+            stop_host(shared, pid);
+            break;
+        }
+
+        receive_events(shared);
+        publish_state(shared);
+
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            receive_events(shared);
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                // Stopped by itself, like at the end of a replay
+                atomic_store(&auto_splitter_enabled, false);
+                break;
+            }
+
+            if (WIFSIGNALED(status)) {
+                printf("[sandbox] Auto splitter host killed by signal %d, restarting\n", WTERMSIG(status));
+            } else {
+                printf("[sandbox] Auto splitter host exited with code %d, restarting\n", WEXITSTATUS(status));
+            }
+            // Back off if it keeps crashing right away
+            restart_delay = now_ms() - started_at > RESTART_DELAY_MAX_MS ? RESTART_DELAY_MIN_MS : restart_delay;
+            long long restart_at = now_ms() + restart_delay;
+            while (now_ms() < restart_at && atomic_load(&auto_splitter_enabled) && !atomic_load(&exit_requested)) {
+                usleep(10000);
+            }
+            restart_delay = restart_delay * 2 > RESTART_DELAY_MAX_MS ? RESTART_DELAY_MAX_MS : restart_delay * 2;
+            if (!atomic_load(&auto_splitter_enabled) || atomic_load(&exit_requested)) {
+                break;
+            }
+
+            publish_state(shared);
+            pid = spawn_host(shared_fd, current_file);
+            started_at = now_ms();
+            continue;
+        }
+
+        futex_wait(&shared->main_wake, wake, state_interval_us(shared));
+    }
+
+    // Keep the toggles sent so far, a new host starts from the same loading state
+    prev_is_loading = atomic_load(&shared->loading);
+    munmap(shared, sizeof(LasrShared));
+    close(shared_fd);
+}
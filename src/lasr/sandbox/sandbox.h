@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LASR_HOST_ARG "--lasr-host"
+#define LASR_RING_SIZE 256 // Must be a power of two
+
+/**
+ * Requests sent by the auto splitter host to LibreSplit.
+ */
+typedef enum LasrEventType : uint8_t {
+    LASR_EVENT_START,
+    LASR_EVENT_SPLIT,
+    LASR_EVENT_TOGGLE_LOADING,
+    LASR_EVENT_RESET,
+    LASR_EVENT_GAME_TIME, /*!< The value is the game time in milliseconds */
+    LASR_EVENT_PERMISSION_ERROR, /*!< Reading the game memory was denied */
+} LasrEventType;
+
+/**
+ * An entry of the event ring.
+ */
+typedef struct LasrEvent {
+    LasrEventType type; /*!< What is requested */
+    long long value; /*!< Payload of the request, if any */
+} LasrEvent;
+
+/**
+ * Memory shared between LibreSplit and the auto splitter host.
+ *
+ * Events go from the host to LibreSplit through a single producer, single consumer ring.
+ * The run state goes the other way, tagged with a generation so the host only applies
+ * changes made by LibreSplit and doesn't overwrite its own updates. Each side sleeps on a
+ * futex word that the other side increments when it has something for it.
+ */
+typedef struct LasrShared {
+    atomic_uint head; /*!< Next event to write, only written by the host */
+    atomic_uint tail; /*!< Next event to read, only written by LibreSplit */
+    LasrEvent events[LASR_RING_SIZE]; /*!< The event ring */
+
+    atomic_uint generation; /*!< Incremented by LibreSplit when the run state changes */
+    atomic_bool run_started; /*!< Mirror of run_started */
+    atomic_bool run_finished; /*!< Mirror of run_finished */
+    atomic_bool loading; /*!< The loading state the toggles sent so far lead to */
+    atomic_bool enabled; /*!< Cleared by LibreSplit to stop the host */
+
+    atomic_uint main_wake; /*!< Futex LibreSplit waits on, for new events */
+    atomic_uint host_wake; /*!< Futex the host bridge waits on, for requests, state changes and ring space */
+    atomic_int refresh_rate; /*!< Refresh rate of the auto splitter, how often LibreSplit checks the state */
+} LasrShared;
+
+extern atomic_bool auto_splitter_sandboxed;
+
+void run_auto_splitter_sandboxed();
+int lasr_host_main(int argc, char* argv[]);
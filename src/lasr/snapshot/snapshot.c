@@ -0,0 +1,192 @@
+/** \file snapshot.c
+ *
+ * Per-tick copies of memory regions declared by the auto splitter
+ *
+ * At the start of every tick all the regions are copied with one vectored read, then the
+ * reads falling inside a region are served from the copy instead of costing a syscall each.
+ * All the values read from the same region during a tick come from the same instant.
+ */
+#include "snapshot.h"
+
+#include "../memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A memory region copied at the start of every tick.
+ */
+typedef struct SnapshotRegion {
+    int id; /*!< The handle given to the auto splitter */
+    uintptr_t address; /*!< Start of the region in the game memory */
+    size_t size; /*!< Size of the region */
+    uint8_t* data; /*!< The copy taken at the start of the tick */
+    bool valid; /*!< False if the region couldn't be read this tick */
+} SnapshotRegion;
+
+static SnapshotRegion regions[SNAPSHOT_MAX_REGIONS];
+static int region_count = 0;
+static size_t total_size = 0;
+static int next_id = 1;
+
+static SnapshotRegion stashed_regions[SNAPSHOT_MAX_REGIONS]; /*!< The regions set aside by snapshot_stash */
+static int stashed_count = 0;
+static size_t stashed_size = 0;
+
+/**
+ * Declares a region to be copied at the start of every tick.
+ *
+ * The region is first read at the start of the next tick.
+ *
+ * @param address The start of the region.
+ * @param size The size of the region.
+ *
+ * @return The id of the region, or zero if it can't be added.
+ */
+int snapshot_add(uintptr_t address, size_t size)
+{
+    if (size == 0 || region_count == SNAPSHOT_MAX_REGIONS || size > SNAPSHOT_MAX_SIZE - total_size) {
+        return 0;
+    }
+
+    uint8_t* data = malloc(size);
+    if (!data) {
+        return 0;
+    }
+
+    SnapshotRegion* region = &regions[region_count++];
+    region->id = next_id++;
+    region->address = address;
+    region->size = size;
+    region->data = data;
+    region->valid = false;
+    total_size += size;
+    return region->id;
+}
+
+/**
+ * Stops copying a region.
+ *
+ * @param id The id returned by snapshot_add.
+ *
+ * @return False if there's no region with that id.
+ */
+bool snapshot_remove(int id)
+{
+    for (int i = 0; i < region_count; i++) {
+        if (regions[i].id == id) {
+            total_size -= regions[i].size;
+            free(regions[i].data);
+            regions[i] = regions[--region_count];
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Removes all the regions.
+ */
+void snapshot_clear(void)
+{
+    for (int i = 0; i < region_count; i++) {
+        free(regions[i].data);
+    }
+    region_count = 0;
+    total_size = 0;
+}
+
+/**
+ * Sets the regions aside, starting again without any.
+ *
+ * Used while an auto splitter is reloaded: the new script declares its own regions, and
+ * the old ones are brought back if it fails.
+ */
+void snapshot_stash(void)
+{
+    snapshot_unstash(false);
+    memcpy(stashed_regions, regions, region_count * sizeof(SnapshotRegion));
+    stashed_count = region_count;
+    stashed_size = total_size;
+    region_count = 0;
+    total_size = 0;
+}
+
+/**
+ * Ends a snapshot_stash.
+ *
+ * @param restore True to bring the stashed regions back in place of the current ones,
+ * false to drop them.
+ */
+void snapshot_unstash(bool restore)
+{
+    if (restore) {
+        snapshot_clear();
+        memcpy(regions, stashed_regions, stashed_count * sizeof(SnapshotRegion));
+        region_count = stashed_count;
+        total_size = stashed_size;
+    } else {
+        for (int i = 0; i < stashed_count; i++) {
+            free(stashed_regions[i].data);
+        }
+    }
+    stashed_count = 0;
+    stashed_size = 0;
+}
+
+/**
+ * Copies all the regions from the game memory, to be called at the start of every tick.
+ *
+ * The regions are read in one go. If one of them fails, the ones after it are read
+ * separately so a single unmapped region doesn't invalidate the others.
+ */
+void snapshot_tick(void)
+{
+    if (region_count == 0) {
+        return;
+    }
+
+    struct iovec local[SNAPSHOT_MAX_REGIONS];
+    struct iovec remote[SNAPSHOT_MAX_REGIONS];
+    for (int i = 0; i < region_count; i++) {
+        regions[i].valid = false;
+        local[i] = (struct iovec) { regions[i].data, regions[i].size };
+        remote[i] = (struct iovec) { (void*)regions[i].address, regions[i].size };
+    }
+
+    ssize_t n_read = read_process_memory_vector(local, remote, region_count);
+    size_t remaining = n_read > 0 ? (size_t)n_read : 0;
+    int i = 0;
+    for (; i < region_count && remaining >= regions[i].size; i++) {
+        regions[i].valid = true;
+        remaining -= regions[i].size;
+    }
+
+    // The read stopped at region i, skip it and retry the rest
+    for (i++; i < region_count; i++) {
+        regions[i].valid = read_process_memory_vector(&local[i], &remote[i], 1) == (ssize_t)regions[i].size;
+    }
+}
+
+/**
+ * Serves a read from the regions copied this tick.
+ *
+ * @param address The address to read from.
+ * @param buffer The buffer to read into.
+ * @param size The number of bytes to read.
+ *
+ * @return False if the read isn't fully inside a region, leaving the buffer untouched.
+ */
+bool snapshot_lookup(uintptr_t address, void* buffer, size_t size)
+{
+    for (int i = 0; i < region_count; i++) {
+        const SnapshotRegion* region = &regions[i];
+        if (region->valid && address >= region->address && size <= region->size
+            && address - region->address <= region->size - size) {
+            memcpy(buffer, region->data + (address - region->address), size);
+            return true;
+        }
+    }
+    return false;
+}
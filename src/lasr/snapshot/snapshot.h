@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SNAPSHOT_MAX_REGIONS 64
+#define SNAPSHOT_MAX_SIZE (16 * 1024 * 1024) // Total bytes copied each tick
+
+int snapshot_add(uintptr_t address, size_t size);
+bool snapshot_remove(int id);
+void snapshot_clear(void);
+void snapshot_stash(void);
+void snapshot_unstash(bool restore);
+void snapshot_tick(void);
+bool snapshot_lookup(uintptr_t address, void* buffer, size_t size);
@@ -0,0 +1,275 @@
+/** \file types.c
+ *
+ * Parsing and description of the value types used by the memory reading functions
+ */
+#include "types.h"
+
+#include "int64/int64.h"
+
+#include <lauxlib.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Registry key of the name -> handle cache, shared with the T global
+#define TYPES_REGISTRY_KEY "LASR.Types"
+
+const LasrTypeInfo lasr_types[LASR_TYPE_COUNT] = {
+    [LASR_TYPE_INVALID] = { NULL, 0, 0, 0 },
+    [LASR_TYPE_SBYTE] = { "sbyte", sizeof(int8_t), 0, 0 },
+    [LASR_TYPE_BYTE] = { "byte", sizeof(uint8_t), 0, 0 },
+    [LASR_TYPE_SHORT] = { "short", sizeof(int16_t), 0, 0 },
+    [LASR_TYPE_USHORT] = { "ushort", sizeof(uint16_t), 0, 0 },
+    [LASR_TYPE_INT] = { "int", sizeof(int32_t), 0, 0 },
+    [LASR_TYPE_UINT] = { "uint", sizeof(uint32_t), 0, 0 },
+    [LASR_TYPE_LONG] = { "long", sizeof(int64_t), 0, 0 },
+    [LASR_TYPE_ULONG] = { "ulong", sizeof(uint64_t), 0, 0 },
+    [LASR_TYPE_INT64] = { "int64", sizeof(int64_t), 0, 0 },
+    [LASR_TYPE_UINT64] = { "uint64", sizeof(uint64_t), 0, 0 },
+    [LASR_TYPE_FLOAT] = { "float", sizeof(float), 0, 0 },
+    [LASR_TYPE_DOUBLE] = { "double", sizeof(double), 0, 0 },
+    [LASR_TYPE_BOOL] = { "bool", sizeof(bool), 0, 0 },
+    [LASR_TYPE_STRING] = { "string", sizeof(char), 0, 2 },
+    [LASR_TYPE_WSTRING] = { "wstring", sizeof(uint16_t), 0, 2 },
+    [LASR_TYPE_LSTRING] = { "lstring", sizeof(char), sizeof(int32_t), 1 },
+    [LASR_TYPE_LWSTRING] = { "lwstring", sizeof(uint16_t), sizeof(int32_t), 1 },
+    [LASR_TYPE_BYTE_ARRAY] = { "byte", sizeof(uint8_t), 0, 1 },
+};
+
+/**
+ * Parses a type name.
+ *
+ * @param name The type name, like "int" or "string32".
+ * @param[out] handle The parsed type.
+ *
+ * @return False if the name is not a valid type.
+ */
+bool lasr_parse_type(const char* name, LasrTypeHandle* handle)
+{
+    for (int type = LASR_TYPE_INVALID + 1; type < LASR_TYPE_COUNT; type++) {
+        const LasrTypeInfo* info = &lasr_types[type];
+        if (info->min_count == 0) {
+            if (strcmp(name, info->name) == 0) {
+                *handle = (LasrTypeHandle) { type, 0 };
+                return true;
+            }
+            continue;
+        }
+
+        size_t prefix_length = strlen(info->name);
+        if (strncmp(name, info->name, prefix_length) != 0) {
+            continue;
+        }
+        char* end;
+        long count = strtol(name + prefix_length, &end, 10);
+        if (end == name + prefix_length || *end != '\0') {
+            continue;
+        }
+        if (count < info->min_count || count > 0xFFFFFF) {
+            return false;
+        }
+        *handle = (LasrTypeHandle) { type, count };
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Encodes a type handle as a Lua number.
+ */
+static lua_Number encode_handle(LasrTypeHandle handle)
+{
+    return handle.type + (lua_Number)handle.count * 256;
+}
+
+/**
+ * Decodes a type handle passed from Lua as a number.
+ *
+ * @return False if the number is not a valid handle.
+ */
+static bool decode_handle(lua_Integer value, LasrTypeHandle* handle)
+{
+    LasrType type = value & 0xFF;
+    uint32_t count = value >> 8;
+    if (value < 0 || type == LASR_TYPE_INVALID || type >= LASR_TYPE_COUNT) {
+        return false;
+    }
+    if ((lasr_types[type].min_count == 0) != (count == 0) || count < lasr_types[type].min_count) {
+        return false;
+    }
+    *handle = (LasrTypeHandle) { type, count };
+    return true;
+}
+
+/**
+ * Gets the type passed as an argument from Lua.
+ *
+ * The argument can be either a handle, like `T.int`, or a type name. Names are only
+ * parsed the first time they are seen, then they are looked up in the handles cache.
+ *
+ * @param L The Lua state.
+ * @param index The stack index of the argument.
+ * @param[out] handle The type.
+ *
+ * @return False if the argument is not a valid type.
+ */
+bool lasr_check_type(lua_State* L, int index, LasrTypeHandle* handle)
+{
+    if (index < 0 && index > LUA_REGISTRYINDEX) {
+        index = lua_gettop(L) + index + 1;
+    }
+
+    int arg_type = lua_type(L, index);
+    if (arg_type == LUA_TNUMBER) {
+        return decode_handle(lua_tointeger(L, index), handle);
+    }
+    if (arg_type != LUA_TSTRING) {
+        return false;
+    }
+
+    lua_getfield(L, LUA_REGISTRYINDEX, TYPES_REGISTRY_KEY);
+    lua_pushvalue(L, index);
+    lua_rawget(L, -2);
+    if (lua_isnumber(L, -1)) {
+        bool valid = decode_handle(lua_tointeger(L, -1), handle);
+        lua_pop(L, 2);
+        return valid;
+    }
+    lua_pop(L, 1);
+
+    if (!lasr_parse_type(lua_tostring(L, index), handle)) {
+        lua_pop(L, 1);
+        return false;
+    }
+    lua_pushvalue(L, index);
+    lua_pushnumber(L, encode_handle(*handle));
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+    return true;
+}
+
+/**
+ * Gets the size in memory of a value of the given type.
+ *
+ * @param handle The type.
+ *
+ * @return The size in bytes.
+ */
+uint32_t lasr_type_size(LasrTypeHandle handle)
+{
+    const LasrTypeInfo* info = &lasr_types[handle.type];
+    if (info->min_count == 0) {
+        return info->size;
+    }
+    return info->prefix + info->size * handle.count;
+}
+
+/**
+ * Checks if a type is a single number or boolean.
+ *
+ * @param type The type.
+ *
+ * @return True for the fixed size types.
+ */
+bool lasr_type_is_scalar(LasrType type)
+{
+    return type != LASR_TYPE_INVALID && type < LASR_TYPE_COUNT && lasr_types[type].min_count == 0;
+}
+
+/**
+ * Pushes a scalar value decoded from memory read from the game.
+ *
+ * @param L The Lua state.
+ * @param type The type of the value, must be a scalar type.
+ * @param data The bytes of the value.
+ */
+void lasr_push_value(lua_State* L, LasrType type, const uint8_t* data)
+{
+    switch (type) {
+#define PUSH_VALUE(lasr_type, c_type, push)  \
+    case lasr_type: {                        \
+        c_type value;                        \
+        memcpy(&value, data, sizeof(value)); \
+        push(L, value);                      \
+        break;                               \
+    }
+        PUSH_VALUE(LASR_TYPE_SBYTE, int8_t, lua_pushinteger)
+        PUSH_VALUE(LASR_TYPE_BYTE, uint8_t, lua_pushinteger)
+        PUSH_VALUE(LASR_TYPE_SHORT, int16_t, lua_pushinteger)
+        PUSH_VALUE(LASR_TYPE_USHORT, uint16_t, lua_pushinteger)
+        PUSH_VALUE(LASR_TYPE_INT, int32_t, lua_pushinteger)
+        PUSH_VALUE(LASR_TYPE_UINT, uint32_t, lua_pushinteger)
+        PUSH_VALUE(LASR_TYPE_FLOAT, float, lua_pushnumber)
+        PUSH_VALUE(LASR_TYPE_DOUBLE, double, lua_pushnumber)
+#undef PUSH_VALUE
+        case LASR_TYPE_LONG:
+        case LASR_TYPE_ULONG:
+        case LASR_TYPE_INT64:
+        case LASR_TYPE_UINT64: {
+            uint64_t value;
+            memcpy(&value, data, sizeof(value));
+            bool is_unsigned = type == LASR_TYPE_ULONG || type == LASR_TYPE_UINT64;
+            if (type == LASR_TYPE_LONG || type == LASR_TYPE_ULONG) {
+                int64_push_exact(L, value, is_unsigned);
+            } else {
+                int64_push(L, value, is_unsigned);
+            }
+            break;
+        }
+        case LASR_TYPE_BOOL:
+            lua_pushboolean(L, data[0] != 0);
+            break;
+        default:
+            lua_pushnil(L);
+            break;
+    }
+}
+
+/**
+ * The __index metamethod of the T table, parsing sized type names on first use.
+ *
+ * @param L The Lua state.
+ *
+ * @return Always 1, the handle or nil if the name is not a valid type.
+ */
+static int types_index(lua_State* L)
+{
+    LasrTypeHandle handle;
+    if (lua_type(L, 2) != LUA_TSTRING || !lasr_parse_type(lua_tostring(L, 2), &handle)) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushvalue(L, 2);
+    lua_pushnumber(L, encode_handle(handle));
+    lua_rawset(L, 1);
+    lua_pushnumber(L, encode_handle(handle));
+    return 1;
+}
+
+/**
+ * Creates the T global, holding the handles of all the types.
+ *
+ * The fixed size types are filled in right away, sized ones like `T.string32` are
+ * added the first time they're used. The same table caches the names passed to
+ * the reading functions as strings.
+ *
+ * @param L The Lua state.
+ */
+void lasr_push_types(lua_State* L)
+{
+    lua_newtable(L);
+    for (int type = LASR_TYPE_INVALID + 1; type < LASR_TYPE_COUNT; type++) {
+        if (lasr_types[type].min_count == 0) {
+            lua_pushnumber(L, encode_handle((LasrTypeHandle) { type, 0 }));
+            lua_setfield(L, -2, lasr_types[type].name);
+        }
+    }
+
+    lua_newtable(L);
+    lua_pushcfunction(L, types_index);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, -2);
+
+    lua_pushvalue(L, -1);
+    lua_setfield(L, LUA_REGISTRYINDEX, TYPES_REGISTRY_KEY);
+    lua_setglobal(L, LASR_TYPES_TABLE);
+}
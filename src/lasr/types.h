@@ -0,0 +1,62 @@
+#pragma once
+
+#include <lua.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LASR_TYPES_TABLE "T"
+
+/**
+ * Value types understood by readAddress and the other memory reading functions.
+ */
+typedef enum LasrType : uint8_t {
+    LASR_TYPE_INVALID,
+    LASR_TYPE_SBYTE,
+    LASR_TYPE_BYTE,
+    LASR_TYPE_SHORT,
+    LASR_TYPE_USHORT,
+    LASR_TYPE_INT,
+    LASR_TYPE_UINT,
+    LASR_TYPE_LONG,
+    LASR_TYPE_ULONG,
+    LASR_TYPE_INT64, /*!< Like long, but always boxed */
+    LASR_TYPE_UINT64, /*!< Like ulong, but always boxed */
+    LASR_TYPE_FLOAT,
+    LASR_TYPE_DOUBLE,
+    LASR_TYPE_BOOL,
+    LASR_TYPE_STRING, /*!< stringN */
+    LASR_TYPE_WSTRING, /*!< wstringN */
+    LASR_TYPE_LSTRING, /*!< lstringN */
+    LASR_TYPE_LWSTRING, /*!< lwstringN */
+    LASR_TYPE_BYTE_ARRAY, /*!< byteN */
+    LASR_TYPE_COUNT,
+} LasrType;
+
+/**
+ * A parsed type name: the type and, for strings and arrays, the N in its name.
+ *
+ * Handed to Lua as a number, with the type in the lowest 8 bits and the count above.
+ */
+typedef struct LasrTypeHandle {
+    LasrType type; /*!< The type */
+    uint32_t count; /*!< The N of sized types, zero otherwise */
+} LasrTypeHandle;
+
+/**
+ * Static description of a type.
+ */
+typedef struct LasrTypeInfo {
+    const char* name; /*!< The type name, or its prefix for sized types */
+    uint32_t size; /*!< The size of the value, or of each element for sized types */
+    uint32_t prefix; /*!< Bytes preceding the elements of sized types */
+    uint32_t min_count; /*!< Smallest N accepted for sized types, zero for fixed size types */
+} LasrTypeInfo;
+
+extern const LasrTypeInfo lasr_types[LASR_TYPE_COUNT];
+
+bool lasr_parse_type(const char* name, LasrTypeHandle* handle);
+bool lasr_check_type(lua_State* L, int index, LasrTypeHandle* handle);
+uint32_t lasr_type_size(LasrTypeHandle handle);
+bool lasr_type_is_scalar(LasrType type);
+void lasr_push_value(lua_State* L, LasrType type, const uint8_t* data);
+void lasr_push_types(lua_State* L);
@@ -2,6 +2,7 @@
 #include "src/lasr/maps/maps.h"
 
 #include <glib.h>
+#include <stdatomic.h>
 #include <stdio.h>
 
 game_process process;
@@ -27,6 +28,33 @@ uintptr_t find_base_address(const char* module)
 
 gboolean display_non_capable_mem_read_dialog(void* data);
 
+/**
+ * Shows the dialog about the missing permission to read the game memory, once.
+ *
+ * Must be called from the LibreSplit process, the dialog is shown by the GTK main loop.
+ */
+void show_permission_error_dialog(void)
+{
+    static atomic_bool shown = false;
+    if (!atomic_exchange(&shown, true)) {
+        g_idle_add(display_non_capable_mem_read_dialog, NULL);
+    }
+}
+
+static void (*permission_error_handler)(void) = show_permission_error_dialog; /*!< Reports a denied memory read */
+
+/**
+ * Sets the function called when reading the game memory is denied.
+ *
+ * The sandboxed host has no GTK main loop, it sends the error to LibreSplit instead.
+ *
+ * @param handler The function.
+ */
+void set_permission_error_handler(void (*handler)(void))
+{
+    permission_error_handler = handler;
+}
+
 /**
  * Prints a memory error to stdout.
  *
@@ -54,7 +82,7 @@ bool handle_memory_error(uint32_t err)
 
             if (!shownDialog) {
                 shownDialog = true;
-                g_idle_add(display_non_capable_mem_read_dialog, NULL);
+                permission_error_handler();
             }
 
             break;
@@ -31,5 +31,7 @@ typedef struct ProcessMap {
 } ProcessMap;
 
 uintptr_t find_base_address(const char* module);
+void show_permission_error_dialog(void);
+void set_permission_error_handler(void (*handler)(void));
 bool handle_memory_error(uint32_t err);
 const char* value_to_c_string(lua_State* L, int index);
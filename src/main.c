@@ -1,3 +1,5 @@
+#include "analytics.h"
+#include "comparison.h"
 #include "gui/app_window.h"
 #include "gui/component/components.h"
 #include "gui/game.h"
@@ -7,15 +9,15 @@
 #include "gui/timer.h"
 #include "gui/utils.h"
 #include "gui/welcome_box.h"
-#include "keybinds/delayed_handlers.h"
 #include "keybinds/keybinds.h"
 #include "keybinds/keybinds_callbacks.h"
 #include "lasr/auto-splitter.h"
+#include "lasr/profiler/profiler.h"
+#include "lasr/sandbox/sandbox.h"
 #include "server.h"
 #include "settings/settings.h"
 #include "settings/utils.h"
 #include "shared.h"
-#include "src/keybinds/delayed_callbacks.h"
 #include "timer.h"
 
 #include <gtk/gtk.h>
@@ -51,6 +53,10 @@ atomic_bool exit_requested = 0; /*!< Set to 1 when LibreSplit is exiting */
 static void ls_app_window_destroy(GtkWidget* widget, gpointer data)
 {
     LSAppWindow* win = (LSAppWindow*)widget;
+    if (win->draw_source) {
+        g_source_remove(win->draw_source);
+        win->draw_source = 0;
+    }
     if (win->timer) {
         ls_timer_release(win->timer);
     }
@@ -74,64 +80,95 @@ static void ls_app_window_destroy(GtkWidget* widget, gpointer data)
     }
 }
 
+// Global application instance for CTL command handling
+static LSApp* g_app = NULL;
+
+static atomic_bool auto_splitter_events_pending = false; /*!< An idle callback is due to handle them */
+
+static void ls_app_notify_auto_splitter(void);
+
 /**
- * Updates the internal state of the LibreSplit Window.
+ * Hides the cursor over the window once it's realized, if requested.
  *
+ * @param widget The LibreSplit window, as a widget.
  * @param data Pointer to the LibreSplit Window.
  */
-static gboolean ls_app_window_step(gpointer data)
+static void ls_app_window_realize(GtkWidget* widget, gpointer data)
 {
     LSAppWindow* win = data;
-    long long now = ls_time_now();
-    static int set_cursor;
-    if (win->opts.hide_cursor && !set_cursor) {
-        GdkWindow* gdk_window = gtk_widget_get_window(GTK_WIDGET(win));
-        if (gdk_window) {
-            GdkCursor* cursor = gdk_cursor_new_for_display(win->display, GDK_BLANK_CURSOR);
-            gdk_window_set_cursor(gdk_window, cursor);
-            set_cursor = 1;
-        }
+    if (win->opts.hide_cursor) {
+        GdkCursor* cursor = gdk_cursor_new_for_display(win->display, GDK_BLANK_CURSOR);
+        gdk_window_set_cursor(gtk_widget_get_window(widget), cursor);
+        g_object_unref(cursor);
     }
-    if (win->timer) {
-        ls_timer_step(win->timer, now);
+}
 
-        if (atomic_load(&auto_splitter_enabled)) {
-            if (atomic_load(&call_start) && !win->timer->loading) {
-                timer_start(win, true);
-                atomic_store(&call_start, 0);
-            }
-            if (atomic_load(&call_split)) {
-                timer_split(win, true);
-                atomic_store(&call_split, 0);
-            }
-            if (atomic_load(&toggle_loading)) {
-                win->timer->loading = !win->timer->loading;
-                if (win->timer->running && win->timer->loading) {
-                    timer_stop(win);
-                } else if (win->timer->started && !win->timer->running && !win->timer->loading) {
-                    timer_start(win, true);
-                }
-                atomic_store(&toggle_loading, 0);
-            }
-            if (atomic_load(&call_reset)) {
-                timer_reset(win);
-                atomic_store(&run_started, false);
-                atomic_store(&call_reset, 0);
-            }
-            if (atomic_load(&update_game_time)) {
-                // Update the timer with the game time from auto-splitter
-                win->timer->time = atomic_load(&game_time_value);
-                atomic_store(&update_game_time, false);
-            }
+/**
+ * Applies the requests made by the auto splitter to the timer.
+ *
+ * @param data Unused.
+ */
+static gboolean ls_app_auto_splitter_events(gpointer data)
+{
+    atomic_store(&auto_splitter_events_pending, false);
+
+    GList* windows = g_app ? gtk_application_get_windows(GTK_APPLICATION(g_app)) : NULL;
+    if (!windows) {
+        return G_SOURCE_REMOVE;
+    }
+    LSAppWindow* win = LS_APP_WINDOW(windows->data);
+    if (!win->timer || !atomic_load(&auto_splitter_enabled)) {
+        return G_SOURCE_REMOVE;
+    }
+
+    if (atomic_load(&call_start) && !win->timer->loading) {
+        timer_start(win, true);
+        atomic_store(&call_start, 0);
+    }
+    if (atomic_load(&call_split)) {
+        timer_split(win, true);
+        atomic_store(&call_split, 0);
+    }
+    if (atomic_load(&toggle_loading)) {
+        // Loads only pause the game time, the real time keeps running
+        ls_timer_step(win->timer, ls_time_now());
+        ls_timer_set_loading(win->timer, !win->timer->loading);
+        atomic_store(&toggle_loading, 0);
+    }
+    if (atomic_load(&call_reset)) {
+        timer_reset(win);
+        atomic_store(&run_started, false);
+        atomic_store(&call_reset, 0);
+    }
+    if (atomic_load(&update_game_time)) {
+        // Update the timer with the game time from auto-splitter
+        ls_timer_step(win->timer, ls_time_now());
+        ls_timer_set_game_time(win->timer, atomic_load(&game_time_value));
+        atomic_store(&update_game_time, false);
+        if (!win->timer->running) {
+            ls_app_window_redraw(win);
         }
     }
-    process_delayed_handlers(win);
+    if (atomic_load(&call_start) && !win->timer->loading) {
+        // The start came during a load, which is now over
+        ls_app_notify_auto_splitter();
+    }
 
-    return TRUE;
+    return G_SOURCE_REMOVE;
 }
 
-// Global application instance for CTL command handling
-static LSApp* g_app = NULL;
+/**
+ * Wakes the main loop up to apply the requests of the auto splitter.
+ *
+ * Called from the auto splitter thread every time it makes a request, the requests
+ * made before the callback runs are handled together.
+ */
+static void ls_app_notify_auto_splitter(void)
+{
+    if (!atomic_exchange(&auto_splitter_events_pending, true)) {
+        g_idle_add_full(G_PRIORITY_DEFAULT, ls_app_auto_splitter_events, NULL, NULL);
+    }
+}
 
 // Function to handle CTL commands from the server thread
 void handle_ctl_command(CTLCommand command)
@@ -169,34 +206,25 @@ void handle_ctl_command(CTLCommand command)
             timer_skip(win);
             break;
         case CTL_CMD_EXIT:
+            save_game_shutdown();
             exit(0);
             break;
+        case CTL_CMD_PROFILE_DUMP:
+            profiler_dump(stdout);
+            break;
+        case CTL_CMD_STATS_DUMP:
+            if (win->game) {
+                ls_stats_dump(win->game, win->game->stats, stdout);
+            } else {
+                printf("No split file loaded\n");
+            }
+            break;
         default:
             printf("Unknown CTL command: %d\n", command);
             break;
     }
 }
 
-static gboolean ls_app_window_draw(gpointer data)
-{
-    LSAppWindow* win = data;
-    if (win->timer) {
-        GList* l;
-        for (l = win->components; l != NULL; l = l->next) {
-            LSComponent* component = l->data;
-            if (component->ops->draw) {
-                component->ops->draw(component, win->game, win->timer);
-            }
-        }
-    } else {
-        GdkRectangle rect;
-        gtk_widget_get_allocation(GTK_WIDGET(win), &rect);
-        gdk_window_invalidate_rect(gtk_widget_get_window(GTK_WIDGET(win)),
-            &rect, FALSE);
-    }
-    return TRUE;
-}
-
 static void ls_app_window_init(LSAppWindow* win)
 {
     const char* theme;
@@ -294,10 +322,10 @@ static void ls_app_window_init(LSAppWindow* win)
     gtk_container_add(GTK_CONTAINER(win->box), win->footer);
     gtk_widget_show(win->footer);
 
-    // Update the internal state every millisecond
-    g_timeout_add(1, ls_app_window_step, win);
-    // Draw the window at 30 FPS
-    g_timeout_add((int)(1000 / 30.), ls_app_window_draw, win);
+    // Nothing polls the timer, it's only redrawn when something happens or while it runs
+    win->draw_source = 0;
+    g_signal_connect(win, "realize",
+        G_CALLBACK(ls_app_window_realize), win);
 }
 
 static void ls_app_window_class_init(LSAppWindowClass* class)
@@ -347,6 +375,7 @@ static void ls_app_window_open(LSAppWindow* win, const char* file)
     } else {
         ls_app_window_show_game(win);
     }
+    ls_app_window_redraw(win);
 }
 
 /**
@@ -543,21 +572,24 @@ bool ls_is_timer_better(ls_game* game, ls_timer* timer)
 {
     int i;
     // Find the latest split with a time
+    long long time = 0;
     for (i = game->split_count - 1; i >= 0; i--) {
-        if (timer->split_times[i] != 0ll || game->split_times[i] != 0ll) {
+        // Upcoming splits hold the times of the comparison, which may not be the PB
+        time = i < timer->curr_split ? timer->split_times[i] : game->split_times[i];
+        if (time != 0ll || game->split_times[i] != 0ll) {
             break;
         }
     }
     if (i < 0) {
         return true;
     }
-    if (timer->split_times[i] == 0ll) {
+    if (time == 0ll) {
         return false;
     }
     if (game->split_times[i] == 0ll) {
         return true;
     }
-    return timer->split_times[i] <= game->split_times[i];
+    return time <= game->split_times[i];
 }
 
 /**
@@ -707,6 +739,7 @@ static void quit_activated(GSimpleAction* action,
     if (win->welcome_box) {
         welcome_box_destroy(win->welcome_box);
     }
+    save_game_shutdown();
     exit(0);
 }
 
@@ -746,6 +779,30 @@ static void menu_toggle_win_on_top(GtkCheckMenuItem* menu_item,
     win->opts.win_on_top = active;
 }
 
+/**
+ * Callback to change the comparison the run is compared against.
+ *
+ * @param menu_item Pointer to the menu item that triggered this callback.
+ * @param app Pointer to the LibreSplit application.
+ */
+static void menu_set_comparison(GtkCheckMenuItem* menu_item, gpointer app)
+{
+    if (!gtk_check_menu_item_get_active(menu_item)) {
+        return;
+    }
+    GList* windows = gtk_application_get_windows(GTK_APPLICATION(app));
+    if (!windows) {
+        return;
+    }
+    LSAppWindow* win = LS_APP_WINDOW(windows->data);
+    if (win->timer) {
+        ls_comparison comparison = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(menu_item), "comparison"));
+        ls_timer_step(win->timer, ls_time_now());
+        ls_timer_set_comparison(win->timer, comparison);
+        ls_app_window_redraw(win);
+    }
+}
+
 /**
  * Creates the Context Menu.
  *
@@ -789,6 +846,21 @@ static gboolean button_right_click(GtkWidget* widget, GdkEventButton* event, gpo
         gtk_menu_shell_append(GTK_MENU_SHELL(menu), gtk_separator_menu_item_new());
         gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_reload);
         gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_close);
+        if (win->timer) {
+            GtkWidget* menu_comparison = gtk_menu_item_new_with_label("Compare Against");
+            GtkWidget* comparison_menu = gtk_menu_new();
+            GSList* group = NULL;
+            for (int c = 0; c < LS_COMPARISON_COUNT; c++) {
+                GtkWidget* item = gtk_radio_menu_item_new_with_label(group, ls_comparison_name(c));
+                group = gtk_radio_menu_item_get_group(GTK_RADIO_MENU_ITEM(item));
+                gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(item), win->timer->comparison == (ls_comparison)c);
+                g_object_set_data(G_OBJECT(item), "comparison", GINT_TO_POINTER(c));
+                g_signal_connect(item, "toggled", G_CALLBACK(menu_set_comparison), app);
+                gtk_menu_shell_append(GTK_MENU_SHELL(comparison_menu), item);
+            }
+            gtk_menu_item_set_submenu(GTK_MENU_ITEM(menu_comparison), comparison_menu);
+            gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_comparison);
+        }
         gtk_menu_shell_append(GTK_MENU_SHELL(menu), gtk_separator_menu_item_new());
         gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_enable_win_on_top);
         gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_settings);
@@ -826,6 +898,7 @@ static void ls_app_activate(GApplication* app)
     if (!config_init()) {
         printf("Configuration failed to load, will use defaults\n");
     }
+    ls_time_set_decimals(cfg.libresplit.decimals.value.i);
 
     LSAppWindow* win;
     win = ls_app_window_new(LS_APP(app));
@@ -855,6 +928,7 @@ static void ls_app_activate(GApplication* app)
             strcpy(auto_splitter_file, auto_splitters_path);
         }
     }
+    atomic_store(&auto_splitter_sandboxed, cfg.libresplit.auto_splitter_sandbox.value.b);
     atomic_store(&auto_splitter_enabled, cfg.libresplit.auto_splitter_enabled.value.b);
     g_signal_connect(win, "button_press_event", G_CALLBACK(button_right_click), app);
 }
@@ -909,7 +983,11 @@ static void* ls_auto_splitter(void* arg)
     while (1) {
         if (atomic_load(&auto_splitter_enabled) && auto_splitter_file[0] != '\0') {
             atomic_store(&auto_splitter_running, true);
-            run_auto_splitter();
+            if (atomic_load(&auto_splitter_sandboxed)) {
+                run_auto_splitter_sandboxed();
+            } else {
+                run_auto_splitter();
+            }
         }
         atomic_store(&auto_splitter_running, false);
         if (atomic_load(&exit_requested))
@@ -921,9 +999,16 @@ static void* ls_auto_splitter(void* arg)
 
 int main(int argc, char* argv[])
 {
+    // LibreSplit started again to host a sandboxed auto splitter
+    if (argc > 1 && strcmp(argv[1], LASR_HOST_ARG) == 0) {
+        return lasr_host_main(argc, argv);
+    }
+
     check_directories();
 
     g_app = ls_app_new();
+    auto_splitter_set_notify(ls_app_notify_auto_splitter);
+    save_game_init();
     pthread_t t1; // Auto-splitter thread
     pthread_create(&t1, NULL, &ls_auto_splitter, NULL);
 
@@ -931,6 +1016,7 @@ int main(int argc, char* argv[])
     pthread_create(&t2, NULL, &ls_ctl_server, NULL);
 
     g_application_run(G_APPLICATION(g_app), argc, argv);
+    save_game_shutdown();
 
     pthread_join(t1, NULL);
     pthread_join(t2, NULL);
@@ -31,6 +31,12 @@ AppConfig cfg = {
             .value.b = true,
             .desc = "Enable Auto Splitter",
         },
+        .auto_splitter_sandbox = {
+            .key = "auto_splitter_sandbox",
+            .type = CFG_BOOL,
+            .value.b = false,
+            .desc = "Run the Auto Splitter in a separate process",
+        },
         .global_hotkeys = {
             .key = "global_hotkeys",
             .type = CFG_BOOL,
@@ -29,6 +29,7 @@ typedef struct LibreSplitConfig {
     ConfigEntry start_on_top;
     ConfigEntry hide_cursor;
     ConfigEntry auto_splitter_enabled;
+    ConfigEntry auto_splitter_sandbox;
     ConfigEntry global_hotkeys;
     ConfigEntry theme;
     ConfigEntry theme_variant;
@@ -171,7 +171,7 @@ bool config_save(void)
     strcat(path, "/settings.json");
 
     check_directories();
-    int ret = json_dump_file(root, path, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+    int ret = save_json_file(root, path, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
     json_decref(root);
     return ret == 0;
 }
@@ -1,3 +1,9 @@
+#define _GNU_SOURCE // mkostemp
+
+#include <errno.h>
+#include <fcntl.h>
+#include <jansson.h>
+#include <libgen.h>
 #include <linux/limits.h>
 #include <pwd.h>
 #include <stdio.h>
@@ -71,6 +77,7 @@ void check_directories(void)
     char themes_directory[PATH_MAX];
     char splits_directory[PATH_MAX];
     char runs_directory[PATH_MAX];
+    char cache_directory[PATH_MAX];
 
     strcpy(auto_splitters_directory, libresplit_directory);
     strcat(auto_splitters_directory, "/auto-splitters");
@@ -84,6 +91,9 @@ void check_directories(void)
     strcpy(runs_directory, libresplit_directory);
     strcat(runs_directory, "/runs");
 
+    strcpy(cache_directory, libresplit_directory);
+    strcat(cache_directory, "/cache");
+
     // Make the libresplit directory if it doesn't exist
     mkdir_p(libresplit_directory, 0755);
 
@@ -106,4 +116,70 @@ void check_directories(void)
     if (mkdir(runs_directory, 0755) == -1) {
         // Directory already exists or there was an error
     }
+
+    // Make the auto splitter bytecode cache directory if it doesn't exist
+    if (mkdir(cache_directory, 0755) == -1) {
+        // Directory already exists or there was an error
+    }
+}
+
+/**
+ * Saves JSON to a file, replacing it at once.
+ *
+ * The JSON is written to a temporary file next to it, flushed to the disk and renamed
+ * over the file, so a crash leaves either the old file or the new one, never a part of
+ * it. If the path is a symbolic link, the file it points to is replaced.
+ *
+ * @param json The JSON to save.
+ * @param path The path of the file.
+ * @param flags The jansson encoding flags.
+ *
+ * @return Zero on success, -1 on error.
+ */
+int save_json_file(const json_t* json, const char* path, size_t flags)
+{
+    char target[PATH_MAX];
+    if (!realpath(path, target)) {
+        if (snprintf(target, sizeof(target), "%s", path) >= (int)sizeof(target)) {
+            return -1;
+        }
+    }
+    char temp_path[PATH_MAX];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", target) >= (int)sizeof(temp_path)) {
+        return -1;
+    }
+    int fd = mkostemp(temp_path, O_CLOEXEC);
+    if (fd < 0) {
+        printf("[save_json_file] Can't create %s: %s\n", temp_path, strerror(errno));
+        return -1;
+    }
+
+    // Keep the permissions of the file replaced, the temporary one is private
+    struct stat target_stat;
+    int error = fchmod(fd, stat(target, &target_stat) == 0 ? target_stat.st_mode & 07777 : 0644);
+    if (!error) {
+        error = json_dumpfd(json, fd, flags);
+    }
+    if (!error) {
+        error = fsync(fd);
+    }
+    if (close(fd) && !error) {
+        error = -1;
+    }
+    if (!error) {
+        error = rename(temp_path, target);
+    }
+    if (error) {
+        printf("[save_json_file] Can't save %s: %s\n", target, strerror(errno));
+        unlink(temp_path);
+        return -1;
+    }
+
+    // Make the rename itself durable
+    int dir_fd = open(dirname(temp_path), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return 0;
 }
@@ -1,4 +1,7 @@
 #pragma once
 
+#include <jansson.h>
+
 void get_libresplit_folder_path(char* out_path);
-void check_directories();
\ No newline at end of file
+void check_directories();
+int save_json_file(const json_t* json, const char* path, size_t flags);
@@ -17,6 +17,8 @@ typedef enum CTLCommand : uint8_t {
     CTL_CMD_UNSPLIT, /*!< Undo split */
     CTL_CMD_SKIP, /*!< Skip split */
     CTL_CMD_EXIT, /*!< Exit */
+    CTL_CMD_PROFILE_DUMP, /*!< Print the auto splitter profile */
+    CTL_CMD_STATS_DUMP, /*!< Print the split statistics */
 } CTLCommand;
 
 /**
@@ -3,6 +3,9 @@
  * Implementation of the timer
  */
 #include "timer.h"
+#include "analytics.h"
+#include "comparison.h"
+#include "history.h"
 #include "gui/dialogs.h"
 #include "settings/utils.h"
 
@@ -31,77 +34,112 @@ long long ls_time_now(void)
 }
 
 /**
- * Converts a time string into milliseconds
+ * Converts a time string into microseconds
  *
- * Takes a HH:MM:SS.mmmmmm formatted time string and converts it into
- * milliseconds.
+ * Takes a HH:MM:SS.mmmmmm formatted time string, where the hours and minutes
+ * are optional, and converts it into microseconds in a single pass.
  *
  * @param string The time string to convert, in HH:MM:SS.mmmmmm format
- * @return The time string converted to milliseconds
+ * @return The time string converted to microseconds
  */
 long long ls_time_value(const char* string)
 {
-    char seconds_part[256];
-    double subseconds_part = 0.;
-    int hours = 0;
-    int minutes = 0;
-    int seconds = 0;
-    int sign = 1;
-    if (!string || !strlen(string)) {
+    long long fields[3] = { 0 }; // Up to hours, minutes and seconds, from the left
+    int field_count = 0;
+    long long subseconds = 0;
+    long long sign = 1;
+    if (!string) {
         return 0;
     }
 
-    // Split at the decimal point manually
-    char* dot_pos = strchr(string, '.');
-    if (dot_pos) {
-        strncpy(seconds_part, string, dot_pos - string);
-        seconds_part[dot_pos - string] = '\0';
-
-        // Manually parse the fractional part to avoid locale issues
-        char* frac_part = dot_pos + 1;
-        subseconds_part = 0.0;
-        double multiplier = 0.1;
-
-        for (char* p = frac_part; *p && *p >= '0' && *p <= '9'; p++) {
-            subseconds_part += (*p - '0') * multiplier;
-            multiplier *= 0.1;
-        }
-    } else {
-        strcpy(seconds_part, string);
-        subseconds_part = 0.0;
-    }
-
-    if (seconds_part[0] == '-') {
+    const char* p = string;
+    if (*p == '-') {
         sign = -1;
-        memmove(seconds_part, seconds_part + 1, strlen(seconds_part));
+        p++;
     }
-    switch (sscanf(seconds_part, "%d:%d:%d", &hours, &minutes, &seconds)) {
-        case 2:
-            seconds = minutes;
-            minutes = hours;
-            hours = 0;
-            break;
-        case 1:
-            seconds = hours;
-            minutes = 0;
-            hours = 0;
+    while (field_count < 3 && *p >= '0' && *p <= '9') {
+        long long value = 0;
+        while (*p >= '0' && *p <= '9') {
+            value = value * 10 + (*p++ - '0');
+        }
+        fields[field_count++] = value;
+        if (*p != ':') {
             break;
+        }
+        p++;
+    }
+    if (*p == '.') {
+        // Microseconds are kept, further digits are truncated
+        long long scale = 100000;
+        for (p++; *p >= '0' && *p <= '9'; p++) {
+            subseconds += (*p - '0') * scale;
+            scale /= 10;
+        }
     }
 
-    return sign * ((hours * 60 * 60 + minutes * 60 + seconds) * 1000000LL + (long long)(subseconds_part * 1000000.));
+    long long seconds = 0;
+    for (int i = 0; i < field_count; ++i) {
+        seconds = seconds * 60 + fields[i];
+    }
+    return sign * (seconds * 1000000LL + subseconds);
 }
 
+static int time_decimals = 2; /*!< Decimals shown, from the timer_decimals setting */
+
 /**
- * Converts a time in milliseconds to a formatted string.
+ * Sets the number of decimals shown in the times, from the timer_decimals setting.
+ *
+ * Called when the settings are loaded or changed, so the formatting doesn't have to
+ * read them for every time.
  *
- * Takes a time in milliseconds and converts it into a human-readable format
+ * @param decimals The number of decimals, clamped between 0 and 6.
+ */
+void ls_time_set_decimals(int decimals)
+{
+    time_decimals = decimals < 0 ? 0 : decimals > 6 ? 6 : decimals;
+}
+
+/**
+ * Gets the number of decimals shown in the times.
+ */
+int ls_time_decimals(void)
+{
+    return time_decimals;
+}
+
+/**
+ * Writes a number in decimal, padded with zeros.
+ *
+ * @return The end of the number, not terminated.
+ */
+static char* write_number(char* string, long long value, int width)
+{
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (count < width) {
+        digits[count++] = '0';
+    }
+    while (count) {
+        *string++ = digits[--count];
+    }
+    return string;
+}
+
+/**
+ * Converts a time in microseconds to a formatted string.
+ *
+ * Takes a time in microseconds and converts it into a human-readable format
  * copying it via side-effect into the first and second argument, a bit
  * like strcpy would do.
  *
  * @param string The destination where to copy the formatted string to.
  * @param millis The destination where to copy the subseconds part string to.
  * @param time The time to convert
- * @param serialized Show all 6 decimal places, if set to zero will only show 2
+ * @param serialized Show all 6 decimal places, otherwise the ones of the settings
  * @param delta Show the time as a delta, when negative
  * @param compact Defines whether to use the "extended" or "compact" formatting
  */
@@ -112,60 +150,52 @@ static void ls_time_string_format(char* string,
     int delta,
     int compact)
 {
-    int hours, minutes, seconds;
-    char dot_subsecs[256];
-    const char* sign = "";
-
     // Check time is not 0 or maxed out, otherwise -
     if (time == LLONG_MAX) {
-        sprintf(string, "-");
+        strcpy(string, "-");
         return;
     }
 
+    char* end = string;
     if (time < 0) {
         time = -time;
-        sign = "-";
+        *end++ = '-';
     } else if (delta) {
-        sign = "+";
-    }
-    hours = time / (1000000LL * 60 * 60);
-    minutes = (time / (1000000LL * 60)) % 60;
-    seconds = (time / 1000000LL) % 60;
-    sprintf(dot_subsecs, ".%06lld", time % 1000000LL);
-    int display_decimals = cfg.libresplit.decimals.value.i;
-    if (!serialized) {
-        int subsec_idx = 0;
-        if (display_decimals <= 0) {
-            subsec_idx = 0;
-        } else if (display_decimals > 6) {
-            subsec_idx = 7;
-        } else {
-            subsec_idx = display_decimals + 1;
-        }
-        /* Show only a dot and x decimal places instead of all 6 */
-        memset(&dot_subsecs[subsec_idx], '\0', sizeof(dot_subsecs) - subsec_idx);
-    }
-    if (millis) {
-        strcpy(millis, &dot_subsecs[1]);
-        dot_subsecs[0] = '\0';
+        *end++ = '+';
     }
+    long long hours = time / (1000000LL * 60 * 60);
+    int minutes = (int)((time / (1000000LL * 60)) % 60);
+    int seconds = (int)((time / 1000000LL) % 60);
     if (hours) {
-        if (compact) {
-            sprintf(string, "%s%d:%02d:%02d", sign, hours, minutes, seconds);
-        } else {
-            sprintf(string, "%s%d:%02d:%02d%s",
-                sign, hours, minutes, seconds, dot_subsecs);
-        }
+        end = write_number(end, hours, 1);
+        *end++ = ':';
+        end = write_number(end, minutes, 2);
+        *end++ = ':';
+        end = write_number(end, seconds, 2);
     } else if (minutes) {
-        if (compact) {
-            sprintf(string, "%s%d:%02d", sign, minutes, seconds);
-        } else {
-            sprintf(string, "%s%d:%02d%s",
-                sign, minutes, seconds, dot_subsecs);
-        }
+        end = write_number(end, minutes, 1);
+        *end++ = ':';
+        end = write_number(end, seconds, 2);
     } else {
-        sprintf(string, "%s%d%s", sign, seconds, dot_subsecs);
+        end = write_number(end, seconds, 1);
     }
+
+    // The compact format only drops the subseconds when there are minutes
+    int decimals = serialized ? 6 : time_decimals;
+    long long subseconds = time % 1000000LL;
+    for (int i = decimals; i < 6; ++i) {
+        subseconds /= 10;
+    }
+    if (millis) {
+        if (decimals) {
+            millis = write_number(millis, subseconds, decimals);
+        }
+        *millis = '\0';
+    } else if (decimals && !(compact && (hours || minutes))) {
+        *end++ = '.';
+        end = write_number(end, subseconds, decimals);
+    }
+    *end = '\0';
 }
 
 static void ls_time_string_serialized(char* string,
@@ -194,44 +224,135 @@ void ls_delta_string(char* string, long long time)
     ls_time_string_format(string, NULL, time, 0, 1, 1);
 }
 
+/**
+ * Keys of the times of each timing, in the split files and the attempt log.
+ */
+static const char* timing_keys[LS_TIMING_COUNT] = {
+    [LS_TIMING_REAL] = "real_time",
+    [LS_TIMING_GAME] = "game_time",
+};
+
+static const char* timing_names[LS_TIMING_COUNT] = {
+    [LS_TIMING_REAL] = "real",
+    [LS_TIMING_GAME] = "game",
+};
+
 void ls_game_release(const ls_game* game)
 {
-    int i;
     if (game->path) {
         free(game->path);
     }
-    if (game->title) {
-        free(game->title);
-    }
-    if (game->theme) {
-        free(game->theme);
-    }
-    if (game->theme_variant) {
-        free(game->theme_variant);
+    if (game->arena) {
+        free(game->arena);
     }
-    if (game->split_titles) {
-        for (i = 0; i < game->split_count; ++i) {
-            if (game->split_titles[i]) {
-                free(game->split_titles[i]);
-                free(game->split_icon_paths[i]);
-            }
-        }
-        free(game->split_titles);
-    }
-    if (game->split_times) {
-        free(game->split_times);
+    if (game->comparison_data) {
+        free(game->comparison_data);
     }
-    if (game->segment_times) {
-        free(game->segment_times);
+    if (game->stats) {
+        free(game->stats);
     }
-    if (game->best_splits) {
-        free(game->best_splits);
-    }
-    if (game->best_segments) {
-        free(game->best_segments);
+}
+
+/**
+ * Gets the space a string of a split file takes in the block of the game.
+ */
+static size_t string_size(json_t* value)
+{
+    return json_is_string(value) ? json_string_length(value) + 1 : 0;
+}
+
+/**
+ * Copies a string of a split file to the block of the game.
+ *
+ * @param[in,out] arena The free space of the block, moved past the string.
+ * @param value The string.
+ *
+ * @return The copy, or NULL if the value isn't a string.
+ */
+static char* arena_string(char** arena, json_t* value)
+{
+    if (!json_is_string(value)) {
+        return NULL;
+    }
+    size_t size = json_string_length(value) + 1;
+    char* string = *arena;
+    memcpy(string, json_string_value(value), size);
+    *arena += size;
+    return string;
+}
+
+/**
+ * Takes an array of times from the block of the game.
+ */
+static long long* arena_array(char** arena, size_t count)
+{
+    long long* array = (long long*)*arena;
+    *arena += count * sizeof(long long);
+    return array;
+}
+
+/**
+ * Takes an array of integers from the block of the game.
+ */
+static int* arena_ints(char** arena, size_t count)
+{
+    int* array = (int*)*arena;
+    *arena += count * sizeof(int);
+    return array;
+}
+
+/**
+ * Puts a split in the section named in the split file, if any.
+ *
+ * Consecutive splits with the same section are grouped, a split naming another section
+ * starts a new one.
+ *
+ * @param game The game, with the splits before this one in their sections.
+ * @param i The index of the split.
+ * @param section The section of the split in the split file.
+ * @param[in,out] arena The free space of the block of the game.
+ */
+static void add_to_section(ls_game* game, int i, json_t* section, char** arena)
+{
+    int last = game->section_count - 1;
+    if (!json_is_string(section)) {
+        game->split_sections[i] = -1;
+    } else if (i && last >= 0 && game->split_sections[i - 1] == last
+        && strcmp(game->section_titles[last], json_string_value(section)) == 0) {
+        game->split_sections[i] = last;
+        game->section_ends[last] = i;
+    } else {
+        last = game->section_count++;
+        game->section_titles[last] = arena_string(arena, section);
+        game->section_starts[last] = i;
+        game->section_ends[last] = i;
+        game->split_sections[i] = last;
     }
 }
 
+/**
+ * Gets a time from a split file.
+ *
+ * @return The time, or zero if it's missing.
+ */
+static long long time_field(json_t* object, const char* key)
+{
+    json_t* ref = json_object_get(object, key);
+    return json_is_string(ref) ? ls_time_value(json_string_value(ref)) : 0;
+}
+
+/**
+ * Loads a split file.
+ *
+ * The strings and the times of the splits are kept in a single block, sized from the
+ * parsed file before copying them.
+ *
+ * @param[out] game_ptr The game.
+ * @param path The path of the split file.
+ * @param[out] error_msg Why the file can't be parsed, to be freed.
+ *
+ * @return Non-zero on error.
+ */
 int ls_game_create(ls_game** game_ptr, const char* path, char** error_msg)
 {
     int error = 0;
@@ -261,33 +382,6 @@ int ls_game_create(ls_game** game_ptr, const char* path, char** error_msg)
         sprintf(*error_msg, "%s (%d:%d)", json_error.text, json_error.line, json_error.column);
         goto game_create_done;
     }
-    // copy title
-    ref = json_object_get(json, "title");
-    if (ref) {
-        game->title = strdup(json_string_value(ref));
-        if (!game->title) {
-            error = 1;
-            goto game_create_done;
-        }
-    }
-    // copy theme
-    ref = json_object_get(json, "theme");
-    if (ref) {
-        game->theme = strdup(json_string_value(ref));
-        if (!game->theme) {
-            error = 1;
-            goto game_create_done;
-        }
-    }
-    // copy theme variant
-    ref = json_object_get(json, "theme_variant");
-    if (ref) {
-        game->theme_variant = strdup(json_string_value(ref));
-        if (!game->theme_variant) {
-            error = 1;
-            goto game_create_done;
-        }
-    }
     // get attempt count
     ref = json_object_get(json, "attempt_count");
     if (ref) {
@@ -309,123 +403,99 @@ int ls_game_create(ls_game** game_ptr, const char* path, char** error_msg)
         game->height = json_integer_value(ref);
     }
     // get delay
-    ref = json_object_get(json, "start_delay");
-    if (ref) {
-        game->start_delay = ls_time_value(
-            json_string_value(ref));
-    }
+    game->start_delay = time_field(json, "start_delay");
     // get wr
-    ref = json_object_get(json, "world_record");
-    if (ref) {
-        game->world_record = ls_time_value(
-            json_string_value(ref));
-    }
+    game->world_record = time_field(json, "world_record");
     // get splits
     ref = json_object_get(json, "splits");
-    if (ref) {
-        game->split_count = json_array_size(ref);
-        // allocate titles
-        game->split_titles = calloc(game->split_count,
-            sizeof(char*));
-        if (!game->split_titles) {
-            error = 1;
-            goto game_create_done;
-        }
-        // allocate splits
-        game->split_times = calloc(game->split_count,
-            sizeof(long long));
-        if (!game->split_times) {
-            error = 1;
-            goto game_create_done;
-        }
-        game->split_icon_paths = calloc(game->split_count, sizeof(char*));
-        if (!game->split_icon_paths) {
-            error = 1;
-            goto game_create_done;
-        }
-        game->segment_times = calloc(game->split_count,
-            sizeof(long long));
-        if (!game->segment_times) {
-            error = 1;
-            goto game_create_done;
-        }
-        game->best_splits = calloc(game->split_count,
-            sizeof(long long));
-        if (!game->best_splits) {
-            error = 1;
-            goto game_create_done;
+    game->split_count = json_is_array(ref) ? (int)json_array_size(ref) : 0;
+    // size the block holding the strings and the times of the splits
+    size_t count = game->split_count;
+    size_t arena_size = (4 + LS_TIMING_COUNT) * count * sizeof(long long) + 2 * count * sizeof(char*)
+        + string_size(json_object_get(json, "title"))
+        + string_size(json_object_get(json, "theme"))
+        + string_size(json_object_get(json, "theme_variant"));
+    arena_size += count * sizeof(char*) + 3 * count * sizeof(int); // sections
+    for (i = 0; i < game->split_count; ++i) {
+        json_t* split = json_array_get(ref, i);
+        arena_size += string_size(json_object_get(split, "title"))
+            + string_size(json_object_get(split, "icon"))
+            + string_size(json_object_get(split, "section"));
+    }
+    game->arena = calloc(1, arena_size);
+    if (!game->arena && arena_size) {
+        error = 1;
+        goto game_create_done;
+    }
+    // carve it, the arrays come first to keep them aligned
+    char* arena = game->arena;
+    game->split_times = arena_array(&arena, count);
+    game->segment_times = arena_array(&arena, count);
+    game->best_splits = arena_array(&arena, count);
+    game->best_segments = arena_array(&arena, count);
+    for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+        game->timing_splits[t] = arena_array(&arena, count);
+    }
+    game->split_titles = (char**)arena;
+    arena += count * sizeof(char*);
+    game->split_icon_paths = (char**)arena;
+    arena += count * sizeof(char*);
+    game->section_titles = (char**)arena;
+    arena += count * sizeof(char*);
+    game->split_sections = arena_ints(&arena, count);
+    game->section_starts = arena_ints(&arena, count);
+    game->section_ends = arena_ints(&arena, count);
+    game->title = arena_string(&arena, json_object_get(json, "title"));
+    game->theme = arena_string(&arena, json_object_get(json, "theme"));
+    game->theme_variant = arena_string(&arena, json_object_get(json, "theme_variant"));
+    game->contains_icons = false;
+    // copy splits
+    for (i = 0; i < game->split_count; ++i) {
+        json_t* split = json_array_get(ref, i);
+        game->split_titles[i] = arena_string(&arena, json_object_get(split, "title"));
+        game->split_icon_paths[i] = arena_string(&arena, json_object_get(split, "icon"));
+        if (game->split_icon_paths[i]) {
+            game->contains_icons = true;
         }
-        game->best_segments = calloc(game->split_count,
-            sizeof(long long));
-        if (!game->best_segments) {
-            error = 1;
-            goto game_create_done;
-        }
-        game->contains_icons = false;
-        // copy splits
-        for (i = 0; i < game->split_count; ++i) {
-            json_t* split;
-            json_t* split_ref;
-            split = json_array_get(ref, i);
-            split_ref = json_object_get(split, "title");
-            if (split_ref) {
-                game->split_titles[i] = strdup(
-                    json_string_value(split_ref));
-                if (!game->split_titles[i]) {
-                    error = 1;
-                    goto game_create_done;
-                }
-            }
+        add_to_section(game, i, json_object_get(split, "section"), &arena);
 
-            split_ref = json_object_get(split, "icon");
-            if (split_ref) {
-                game->split_icon_paths[i] = strdup(json_string_value(split_ref));
-                if (!game->split_icon_paths[i]) {
-                    error = 1;
-                    goto game_create_done;
-                }
-                game->contains_icons = true;
-            }
+        game->split_times[i] = time_field(split, "time");
 
-            split_ref = json_object_get(split, "time");
-            if (split_ref) {
-                game->split_times[i] = ls_time_value(
-                    json_string_value(split_ref));
-            }
+        // Check whether the split time is 0, if it is set it to max value
+        if (game->split_times[i] == 0) {
+            game->split_times[i] = LLONG_MAX;
+        }
+        if (i && game->split_times[i] && game->split_times[i - 1]) {
+            game->segment_times[i] = game->split_times[i] - game->split_times[i - 1];
+        } else if (!i && game->split_times[0]) {
+            game->segment_times[0] = game->split_times[0];
+        }
 
-            // Check whether the split time is 0, if it is set it to max value
-            if (game->split_times[i] == 0) {
-                game->split_times[i] = LLONG_MAX;
-            }
-            if (i && game->split_times[i] && game->split_times[i - 1]) {
-                game->segment_times[i] = game->split_times[i] - game->split_times[i - 1];
-            } else if (!i && game->split_times[0]) {
-                game->segment_times[0] = game->split_times[0];
-            }
+        game->best_splits[i] = time_field(split, "best_time");
+        if (!json_object_get(split, "best_time") && game->split_times[i]) {
+            game->best_splits[i] = game->split_times[i];
+        }
 
-            if (game->best_splits[i] == 0) {
-                game->best_splits[i] = LLONG_MAX;
-            }
-            split_ref = json_object_get(split, "best_time");
-            if (split_ref) {
-                game->best_splits[i] = ls_time_value(
-                    json_string_value(split_ref));
-            } else if (game->split_times[i]) {
-                game->best_splits[i] = game->split_times[i];
-            }
+        game->best_segments[i] = time_field(split, "best_segment");
+        if (!json_object_get(split, "best_segment") && game->segment_times[i]) {
+            game->best_segments[i] = game->segment_times[i];
+        }
 
-            if (game->best_segments[i] == 0) {
-                game->best_segments[i] = LLONG_MAX;
-            }
-            split_ref = json_object_get(split, "best_segment");
-            if (split_ref) {
-                game->best_segments[i] = ls_time_value(
-                    json_string_value(split_ref));
-            } else if (game->segment_times[i]) {
-                game->best_segments[i] = game->segment_times[i];
+        // Files saved before both timings were kept only have the one the run used
+        for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+            game->timing_splits[t][i] = time_field(split, timing_keys[t]);
+            if (game->timing_splits[t][i] == 0) {
+                game->timing_splits[t][i] = LLONG_MAX;
             }
         }
     }
+    // compute the comparisons from the attempt log, moving the old runs to it first
+    ls_history_import(game);
+    if (ls_game_load_comparisons(game)) {
+        error = 1;
+        goto game_create_done;
+    }
+    game->stats = ls_stats_load(game);
 game_create_done:
     if (!error) {
         *game_ptr = game;
@@ -443,18 +513,25 @@ void ls_game_update_splits(ls_game* game,
 {
     if (timer->curr_split) {
         int size;
-        if (timer->split_times[game->split_count - 1]
-            && timer->split_times[game->split_count - 1]
-                < game->world_record) {
-            game->world_record = timer->split_times[game->split_count - 1];
-        }
         size = timer->curr_split * sizeof(long long);
-        if (timer->split_times[game->split_count - 1]
-            < game->split_times[game->split_count - 1]) {
-            memcpy(game->split_times, timer->split_times, size);
+        // Splits not reached yet hold the times of the comparison, only a finished run
+        // can be a new personal best
+        if (timer->curr_split == game->split_count) {
+            if (timer->split_times[game->split_count - 1]
+                && timer->split_times[game->split_count - 1]
+                    < game->world_record) {
+                game->world_record = timer->split_times[game->split_count - 1];
+            }
+            if (timer->split_times[game->split_count - 1]
+                < game->split_times[game->split_count - 1]) {
+                memcpy(game->split_times, timer->split_times, size);
+                for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+                    memcpy(game->timing_splits[t], timer->timing_splits[t], size);
+                }
+            }
         }
         memcpy(game->segment_times, timer->segment_times, size);
-        for (int i = 0; i < game->split_count; ++i) {
+        for (int i = 0; i < timer->curr_split; ++i) {
             if (timer->split_times[i] < game->best_splits[i]) {
                 game->best_splits[i] = timer->split_times[i];
             }
@@ -462,6 +539,7 @@ void ls_game_update_splits(ls_game* game,
                 game->best_segments[i] = timer->segment_times[i];
             }
         }
+        ls_game_update_best_comparison(game);
     }
 }
 
@@ -491,9 +569,15 @@ bool ls_timer_has_gold_split(const ls_timer* timer)
     return false;
 }
 
-int ls_game_save(const ls_game* game)
+/**
+ * Serializes a game as it's saved in its split file.
+ *
+ * @param game The game.
+ *
+ * @return The JSON, to be released with json_decref.
+ */
+json_t* ls_game_to_json(const ls_game* game)
 {
-    int error = 0;
     char str[256];
     json_t* json = json_object();
     json_t* splits = json_array();
@@ -521,6 +605,9 @@ int ls_game_save(const ls_game* game)
         json_t* split = json_object();
         json_object_set_new(split, "title", json_string(game->split_titles[i]));
         json_object_set_new(split, "icon", json_string(game->split_icon_paths[i]));
+        if (game->split_sections[i] >= 0) {
+            json_object_set_new(split, "section", json_string(game->section_titles[game->split_sections[i]]));
+        }
 
         // Only save the split if it's above 0. Otherwise it's impossible to beat 0
         if (game->split_times[i] > 0 && game->split_times[i] < LLONG_MAX) {
@@ -535,6 +622,12 @@ int ls_game_save(const ls_game* game)
             ls_time_string_serialized(str, game->best_segments[i]);
             json_object_set_new(split, "best_segment", json_string(str));
         }
+        for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+            if (game->timing_splits[t][i] > 0 && game->timing_splits[t][i] < LLONG_MAX) {
+                ls_time_string_serialized(str, game->timing_splits[t][i]);
+                json_object_set_new(split, timing_keys[t], json_string(str));
+            }
+        }
         json_array_append_new(splits, split);
     }
     json_object_set_new(json, "splits", splits);
@@ -551,13 +644,20 @@ int ls_game_save(const ls_game* game)
     if (game->height) {
         json_object_set_new(json, "height", json_integer(game->height));
     }
-    const int json_dump_result = json_dump_file(json, game->path, JSON_PRESERVE_ORDER | JSON_INDENT(2));
-    if (json_dump_result) {
-        printf("Error dumping JSON:\n%s\n", json_dumps(json, JSON_PRESERVE_ORDER | JSON_INDENT(2)));
-        printf("Error: '%d'\n", json_dump_result);
-        printf("Path: %s\n", game->path);
-        error = 1;
-    }
+    return json;
+}
+
+/**
+ * Saves a game to its split file.
+ *
+ * @param game The game.
+ *
+ * @return Non-zero on error.
+ */
+int ls_game_save(const ls_game* game)
+{
+    json_t* json = ls_game_to_json(game);
+    int error = save_json_file(json, game->path, JSON_PRESERVE_ORDER | JSON_INDENT(2)) != 0;
     json_decref(json);
     return error;
 }
@@ -586,6 +686,13 @@ int ls_run_save(ls_timer* timer, const char* reason)
     }
     json_object_set_new(json, "final_time", json_string(final_time_str));
     json_object_set_new(json, "reason", json_string(reason));
+    json_object_set_new(json, "timing", json_string(timing_names[timer->timing]));
+    for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+        if (timer->timing_times[t] > 0) {
+            ls_time_string_serialized(final_time_str, timer->timing_times[t]);
+            json_object_set_new(json, timing_keys[t], json_string(final_time_str));
+        }
+    }
 
     // Splits Array
     json_t* splits = json_array();
@@ -615,36 +722,36 @@ int ls_run_save(ls_timer* timer, const char* reason)
                 json_object_set_new(split, "time", json_null());
                 json_object_set_new(split, "segment", json_null());
             }
+            for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+                if (timer->timing_splits[t][i] > 0 && timer->timing_splits[t][i] < LLONG_MAX) {
+                    char timing_str[128];
+                    ls_time_string_serialized(timing_str, timer->timing_splits[t][i]);
+                    json_object_set_new(split, timing_keys[t], json_string(timing_str));
+                }
+            }
         }
         json_array_append_new(splits, split);
     }
 
     json_object_set_new(json, "splits", splits);
 
-    char path[PATH_MAX];
-    get_libresplit_folder_path(path);
-    strncat(path, "/runs", sizeof(path) - strlen(path) - 1);
-
     time_t rawtime;
-    struct tm* timeinfo;
     char time_buf[64];
     time(&rawtime);
-    timeinfo = localtime(&rawtime);
-    strftime(time_buf, sizeof(time_buf), "%Y-%m-%d_%H-%M-%S", timeinfo);
+    strftime(time_buf, sizeof(time_buf), "%Y-%m-%d_%H-%M-%S", localtime(&rawtime));
+    json_object_set_new(json, "date", json_string(time_buf));
 
-    char filename[PATH_MAX];
-    int ret = snprintf(filename, sizeof(filename), "%s/run_%s.json", path, time_buf);
-    if (ret < 0 || (size_t)ret >= sizeof(filename)) {
-        printf("Error creating run filename. The path may be too long, aborting save.\n");
-        return 1;
+    ls_attempt attempt = {
+        .reached_split = timer->curr_split,
+        .final_time = timer->time,
+        .finished = strcmp(reason, "FINISHED") == 0,
+    };
+    error = ls_history_append(timer->game->path, json, &attempt);
+    if (!error) {
+        ls_game_update_latest_comparison((ls_game*)timer->game, timer);
     }
-
-    const int json_dump_result = json_dump_file(json, filename, JSON_PRESERVE_ORDER | JSON_INDENT(2));
-    if (json_dump_result) {
-        printf("Error dumping JSON:\n%s\n", json_dumps(json, JSON_PRESERVE_ORDER | JSON_INDENT(2)));
-        printf("Error: '%d'\n", json_dump_result);
-        printf("Path: %s\n", filename);
-        error = 1;
+    if (!error && timer->game->stats) {
+        ls_stats_update(timer->game, timer->game->stats);
     }
 
     json_decref(json);
@@ -674,6 +781,79 @@ void ls_timer_release(const ls_timer* timer)
     if (timer->best_segments) {
         free(timer->best_segments);
     }
+    if (timer->section_deltas) {
+        free(timer->section_deltas);
+    }
+    if (timer->timing_data) {
+        free(timer->timing_data);
+    }
+}
+
+/**
+ * Adds the segment delta of a split to the delta of its section, or takes it out.
+ *
+ * Segments without a time, like the ones of skipped splits and the ones following them,
+ * aren't counted.
+ *
+ * @param timer The timer.
+ * @param i The index of the split, which must be done.
+ * @param sign 1 to add the segment, -1 to take it out.
+ */
+static void section_add_delta(ls_timer* timer, int i, int sign)
+{
+    int section = timer->game->split_sections[i];
+    if (section < 0 || (i && !timer->split_times[i - 1])
+        || timer->segment_times[i] <= 0 || timer->segment_times[i] == LLONG_MAX) {
+        return;
+    }
+    timer->section_deltas[section] += sign * timer->segment_deltas[i];
+}
+
+/**
+ * Sums the segment deltas of the splits done in each section.
+ */
+static void sum_sections(ls_timer* timer)
+{
+    int i;
+    if (!timer->game->section_count) {
+        return;
+    }
+    memset(timer->section_deltas, 0, timer->game->section_count * sizeof(long long));
+    for (i = 0; i < timer->curr_split; ++i) {
+        section_add_delta(timer, i, 1);
+    }
+}
+
+/**
+ * Gets the best time of a segment, as used in the sum of bests.
+ *
+ * @param timer The timer.
+ * @param index The index of the segment.
+ *
+ * @return The best time, or zero if the segment doesn't have one.
+ */
+static long long best_segment(const ls_timer* timer, int index)
+{
+    // Check the segment isn't erroring with LLONG_MAX
+    if (timer->best_segments[index] && timer->best_segments[index] < LLONG_MAX) {
+        return timer->best_segments[index];
+    }
+    if (timer->game->best_segments[index] && timer->game->best_segments[index] < LLONG_MAX) {
+        return timer->game->best_segments[index];
+    }
+    return 0;
+}
+
+/**
+ * Gets the sum of the best segments.
+ *
+ * @param timer The timer.
+ *
+ * @return The sum of bests, or zero if a segment doesn't have a best time yet.
+ */
+long long ls_timer_sum_of_bests(const ls_timer* timer)
+{
+    return timer->missing_best_segments ? 0 : timer->sum_of_bests;
 }
 
 static void reset_timer(ls_timer* timer)
@@ -684,25 +864,31 @@ static void reset_timer(ls_timer* timer)
     timer->start_time = 0;
     timer->curr_split = 0;
     timer->time = -timer->game->start_delay;
+    timer->timing = LS_TIMING_REAL;
     size = timer->game->split_count * sizeof(long long);
-    memcpy(timer->split_times, timer->game->split_times, size);
+    for (i = 0; i < LS_TIMING_COUNT; ++i) {
+        timer->timing_times[i] = timer->time;
+    }
+    memset(timer->timing_data, 0, 3 * LS_TIMING_COUNT * size);
+    memcpy(timer->split_times, timer->comparison_splits, size);
     memset(timer->split_deltas, 0, size);
-    memcpy(timer->segment_times, timer->game->segment_times, size);
+    memcpy(timer->segment_times, timer->comparison_segments, size);
     memset(timer->segment_deltas, 0, size);
     memcpy(timer->best_splits, timer->game->best_splits, size);
     memcpy(timer->best_segments, timer->game->best_segments, size);
     size = timer->game->split_count * sizeof(int);
     memset(timer->split_info, 0, size);
+    sum_sections(timer);
+    // The bests were just copied back, so the sum is walked once here and then
+    // only updated when a best segment changes
     timer->sum_of_bests = 0;
+    timer->missing_best_segments = 0;
     for (i = 0; i < timer->game->split_count; ++i) {
-        // Check no segments are erroring with LLONG_MAX
-        if (timer->best_segments[i] && timer->best_segments[i] < LLONG_MAX) {
-            timer->sum_of_bests += timer->best_segments[i];
-        } else if (timer->game->best_segments[i] && timer->game->best_segments[i] < LLONG_MAX) {
-            timer->sum_of_bests += timer->game->best_segments[i];
+        long long best = best_segment(timer, i);
+        if (best) {
+            timer->sum_of_bests += best;
         } else {
-            timer->sum_of_bests = 0;
-            break;
+            ++timer->missing_best_segments;
         }
     }
 }
@@ -718,6 +904,9 @@ int ls_timer_create(ls_timer** timer_ptr, ls_game* game)
         goto timer_create_done;
     }
     timer->game = game;
+    timer->comparison = LS_COMPARISON_PB;
+    timer->comparison_splits = game->comparison_splits[LS_COMPARISON_PB];
+    timer->comparison_segments = game->comparison_segments[LS_COMPARISON_PB];
     timer->attempt_count = &game->attempt_count;
     timer->finished_count = &game->finished_count;
     // alloc splits
@@ -763,6 +952,26 @@ int ls_timer_create(ls_timer** timer_ptr, ls_game* game)
         error = 1;
         goto timer_create_done;
     }
+    // The split, segment and delta times of each timing, in one block
+    timer->timing_data = calloc(3 * LS_TIMING_COUNT * timer->game->split_count,
+        sizeof(long long));
+    if (!timer->timing_data && timer->game->split_count) {
+        error = 1;
+        goto timer_create_done;
+    }
+    for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+        timer->timing_splits[t] = timer->timing_data + 3 * t * timer->game->split_count;
+        timer->timing_segments[t] = timer->timing_splits[t] + timer->game->split_count;
+        timer->timing_deltas[t] = timer->timing_segments[t] + timer->game->split_count;
+    }
+    if (timer->game->section_count) {
+        timer->section_deltas = calloc(timer->game->section_count,
+            sizeof(long long));
+        if (!timer->section_deltas) {
+            error = 1;
+            goto timer_create_done;
+        }
+    }
     reset_timer(timer);
 timer_create_done:
     if (!error) {
@@ -773,59 +982,180 @@ timer_create_done:
     return error;
 }
 
+/**
+ * Computes the deltas of a split against the comparison, and whether it's behind or
+ * losing time.
+ *
+ * @param timer The timer.
+ * @param i The index of the split, which must have a time.
+ */
+static void compare_split(ls_timer* timer, int i)
+{
+    // calc delta and check it's not an error of LLONG_MAX
+    if (timer->comparison_splits[i] && timer->comparison_splits[i] < LLONG_MAX) {
+        timer->split_deltas[i] = timer->split_times[i] - timer->comparison_splits[i];
+    } else {
+        timer->split_deltas[i] = 0;
+    }
+    // check for behind time
+    if (timer->split_deltas[i] > 0) {
+        timer->split_info[i] |= LS_INFO_BEHIND_TIME;
+    } else {
+        timer->split_info[i] &= ~LS_INFO_BEHIND_TIME;
+    }
+    // For previous segment in footer
+    if ((!i || timer->split_times[i - 1])
+        && timer->comparison_segments[i] && timer->comparison_segments[i] < LLONG_MAX) {
+        timer->segment_deltas[i] = timer->segment_times[i] - timer->comparison_segments[i];
+    } else {
+        timer->segment_deltas[i] = 0;
+    }
+    // check for losing time
+    if (i) {
+        if (timer->split_deltas[i] > timer->split_deltas[i - 1]) {
+            timer->split_info[i] |= LS_INFO_LOSING_TIME;
+        } else {
+            timer->split_info[i] &= ~LS_INFO_LOSING_TIME;
+        }
+    } else if (timer->split_deltas[i] > 0) {
+        timer->split_info[i] |= LS_INFO_LOSING_TIME;
+    } else {
+        timer->split_info[i] &= ~LS_INFO_LOSING_TIME;
+    }
+}
+
+/**
+ * Changes the comparison the run is compared against.
+ *
+ * The comparisons are all computed when the game loads, so this only points the timer
+ * to other arrays and updates the deltas of the splits already done.
+ *
+ * @param timer The timer.
+ * @param comparison The new comparison.
+ */
+void ls_timer_set_comparison(ls_timer* timer, ls_comparison comparison)
+{
+    int i;
+    timer->comparison = comparison;
+    timer->comparison_splits = timer->game->comparison_splits[comparison];
+    timer->comparison_segments = timer->game->comparison_segments[comparison];
+    for (i = 0; i < timer->game->split_count; ++i) {
+        if (i < timer->curr_split) {
+            // Skipped splits don't have a time to compare
+            if (timer->split_times[i]) {
+                compare_split(timer, i);
+            }
+        } else if (i == timer->curr_split && timer->started) {
+            compare_split(timer, i);
+        } else {
+            // Upcoming splits show the times of the comparison
+            timer->split_times[i] = timer->comparison_splits[i];
+            timer->segment_times[i] = timer->comparison_segments[i];
+        }
+    }
+    sum_sections(timer);
+}
+
+/**
+ * Updates the split, segment and delta of the current split in every timing.
+ *
+ * @param timer The timer.
+ * @param i The index of the current split.
+ */
+static void step_timings(ls_timer* timer, int i)
+{
+    for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+        long long* splits = timer->timing_splits[t];
+        const long long* pb = timer->game->timing_splits[t];
+        splits[i] = timer->timing_times[t];
+        if (!i || splits[i - 1]) {
+            timer->timing_segments[t][i] = i ? splits[i] - splits[i - 1] : splits[i];
+        }
+        timer->timing_deltas[t][i] = pb[i] && pb[i] < LLONG_MAX ? splits[i] - pb[i] : 0;
+    }
+}
+
+/**
+ * Clears the times of a split in every timing.
+ */
+static void clear_timings(ls_timer* timer, int i)
+{
+    for (int t = 0; t < LS_TIMING_COUNT; ++t) {
+        timer->timing_splits[t][i] = 0;
+        timer->timing_segments[t][i] = 0;
+        timer->timing_deltas[t][i] = 0;
+    }
+}
+
+/**
+ * Brings the timer up to date, adding the time elapsed since the last step.
+ *
+ * Nothing calls this periodically: it must be called before reading or changing the
+ * state of the timer, which is done by the window actions and the render clock.
+ *
+ * @param timer The timer.
+ * @param now The current monotonic time, from ls_time_now.
+ */
 void ls_timer_step(ls_timer* timer, long long now)
 {
     timer->now = now;
     if (timer->running) {
         long long delta = timer->now - timer->start_time;
-        timer->time += delta; // Accumulate the elapsed time
+        // Accumulate the elapsed time, game time doesn't run during loads
+        timer->timing_times[LS_TIMING_REAL] += delta;
+        if (!timer->loading) {
+            timer->timing_times[LS_TIMING_GAME] += delta;
+        }
+        timer->time = timer->timing_times[timer->timing];
         if (timer->curr_split < timer->game->split_count) {
+            step_timings(timer, timer->curr_split);
             timer->split_times[timer->curr_split] = timer->time;
-            // calc delta and check it's not an error of LLONG_MAX
-            if (timer->game->split_times[timer->curr_split] && timer->game->split_times[timer->curr_split] < LLONG_MAX) {
-                timer->split_deltas[timer->curr_split] = timer->split_times[timer->curr_split]
-                    - timer->game->split_times[timer->curr_split];
-            }
-            // check for behind time
-            if (timer->split_deltas[timer->curr_split] > 0) {
-                timer->split_info[timer->curr_split] |= LS_INFO_BEHIND_TIME;
-            } else {
-                timer->split_info[timer->curr_split] &= ~LS_INFO_BEHIND_TIME;
-            }
             if (!timer->curr_split || timer->split_times[timer->curr_split - 1]) {
-                // calc segment time and delta
+                // calc segment time
                 timer->segment_times[timer->curr_split] = timer->split_times[timer->curr_split];
                 if (timer->curr_split) {
                     timer->segment_times[timer->curr_split] -= timer->split_times[timer->curr_split - 1];
                 }
-                // For previous segment in footer
-                if (timer->game->segment_times[timer->curr_split] && timer->game->segment_times[timer->curr_split] < LLONG_MAX) {
-                    timer->segment_deltas[timer->curr_split] = timer->segment_times[timer->curr_split]
-                        - timer->game->segment_times[timer->curr_split];
-                }
-            }
-            // check for losing time
-            if (timer->curr_split) {
-                if (timer->split_deltas[timer->curr_split]
-                    > timer->split_deltas[timer->curr_split - 1]) {
-                    timer->split_info[timer->curr_split]
-                        |= LS_INFO_LOSING_TIME;
-                } else {
-                    timer->split_info[timer->curr_split]
-                        &= ~LS_INFO_LOSING_TIME;
-                }
-            } else if (timer->split_deltas[timer->curr_split] > 0) {
-                timer->split_info[timer->curr_split]
-                    |= LS_INFO_LOSING_TIME;
-            } else {
-                timer->split_info[timer->curr_split]
-                    &= ~LS_INFO_LOSING_TIME;
             }
+            compare_split(timer, timer->curr_split);
         }
     }
     timer->start_time = now; // Update the start time for the next iteration
 }
 
+/**
+ * Pauses or resumes the game time, for the loads reported by the auto splitter.
+ *
+ * The run is timed with game time from its first load on. Until then both timings are
+ * the same, so the splits already done don't change.
+ *
+ * @param timer The timer, brought up to date with ls_timer_step.
+ * @param loading Whether the game is loading.
+ */
+void ls_timer_set_loading(ls_timer* timer, bool loading)
+{
+    timer->loading = loading;
+    if (loading && timer->started) {
+        timer->timing = LS_TIMING_GAME;
+    }
+}
+
+/**
+ * Sets the game time, as read from the game by the auto splitter.
+ *
+ * @param timer The timer, brought up to date with ls_timer_step.
+ * @param time The game time.
+ */
+void ls_timer_set_game_time(ls_timer* timer, long long time)
+{
+    timer->timing_times[LS_TIMING_GAME] = time;
+    timer->timing = LS_TIMING_GAME;
+    timer->time = time;
+    if (timer->running && timer->curr_split < timer->game->split_count) {
+        step_timings(timer, timer->curr_split);
+    }
+}
+
 int ls_timer_start(ls_timer* timer)
 {
     if (timer->curr_split < timer->game->split_count) {
@@ -842,7 +1172,6 @@ int ls_timer_split(ls_timer* timer)
 {
     if (timer->time > 0) {
         if (timer->curr_split < timer->game->split_count) {
-            int i;
             // check for best split and segment
             if (!timer->best_splits[timer->curr_split]
                 || timer->split_times[timer->curr_split]
@@ -854,23 +1183,20 @@ int ls_timer_split(ls_timer* timer)
             if (!timer->best_segments[timer->curr_split]
                 || timer->segment_times[timer->curr_split]
                     < timer->best_segments[timer->curr_split]) {
+                // update sum of bests with the difference
+                long long previous = best_segment(timer, timer->curr_split);
                 timer->best_segments[timer->curr_split] = timer->segment_times[timer->curr_split];
                 timer->split_info[timer->curr_split]
                     |= LS_INFO_BEST_SEGMENT;
-            }
-            // update sum of bests
-            timer->sum_of_bests = 0;
-            for (i = 0; i < timer->game->split_count; ++i) {
-                // Check if any best segment is missing/LLONG_MAX
-                if (timer->best_segments[i] && timer->best_segments[i] < LLONG_MAX) {
-                    timer->sum_of_bests += timer->best_segments[i];
-                } else if (timer->game->best_segments[i] && timer->game->best_segments[i] < LLONG_MAX) {
-                    timer->sum_of_bests += timer->game->best_segments[i];
-                } else {
-                    timer->sum_of_bests = 0;
-                    break;
+                long long best = best_segment(timer, timer->curr_split);
+                timer->sum_of_bests += best - previous;
+                if (!previous && best) {
+                    --timer->missing_best_segments;
+                } else if (previous && !best) {
+                    ++timer->missing_best_segments;
                 }
             }
+            section_add_delta(timer, timer->curr_split, 1);
 
             ++timer->curr_split;
             // stop timer if last split
@@ -903,6 +1229,7 @@ int ls_timer_skip(ls_timer* timer)
             timer->split_info[timer->curr_split] = 0;
             timer->segment_times[timer->curr_split] = 0;
             timer->segment_deltas[timer->curr_split] = 0;
+            clear_timings(timer, timer->curr_split);
             return ++timer->curr_split;
         }
     }
@@ -914,12 +1241,14 @@ int ls_timer_unsplit(ls_timer* timer)
     if (timer->curr_split) {
         int i;
         int curr = --timer->curr_split;
+        section_add_delta(timer, curr, -1);
         for (i = curr; i < timer->game->split_count; ++i) {
-            timer->split_times[i] = timer->game->split_times[i];
+            timer->split_times[i] = timer->comparison_splits[i];
             timer->split_deltas[i] = 0;
             timer->split_info[i] = 0;
-            timer->segment_times[i] = timer->game->segment_times[i];
+            timer->segment_times[i] = timer->comparison_segments[i];
             timer->segment_deltas[i] = 0;
+            clear_timings(timer, i);
         }
         if (timer->curr_split + 1 == timer->game->split_count) {
             timer->running = 1;
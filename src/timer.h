@@ -1,6 +1,7 @@
 #pragma once
 
 #include "src/settings/definitions.h"
+#include <jansson.h>
 #include <stdatomic.h>
 
 #define LS_INFO_BEHIND_TIME (1)
@@ -10,6 +11,28 @@
 
 extern AppConfig cfg;
 
+/**
+ * The times the run can be compared against.
+ */
+typedef enum ls_comparison {
+    LS_COMPARISON_PB,
+    LS_COMPARISON_BEST_SEGMENTS,
+    LS_COMPARISON_AVERAGE,
+    LS_COMPARISON_MEDIAN,
+    LS_COMPARISON_LATEST,
+    LS_COMPARISON_BALANCED,
+    LS_COMPARISON_COUNT,
+} ls_comparison;
+
+/**
+ * The clocks a run is timed with, both kept during every run.
+ */
+typedef enum ls_timing {
+    LS_TIMING_REAL, // Real time, only paused when the timer is stopped
+    LS_TIMING_GAME, // Game time, paused during loads or set by the auto splitter
+    LS_TIMING_COUNT,
+} ls_timing;
+
 typedef struct ls_game {
     char* path;
     char* title;
@@ -29,6 +52,17 @@ typedef struct ls_game {
     long long* segment_times;
     long long* best_splits;
     long long* best_segments;
+    long long* timing_splits[LS_TIMING_COUNT]; /*!< Split times of the personal best in each timing */
+    int section_count; /*!< Number of groups of splits, zero if they aren't grouped */
+    char** section_titles;
+    int* section_starts; /*!< Index of the first split of each section */
+    int* section_ends; /*!< Index of the last split of each section */
+    int* split_sections; /*!< Section of each split, -1 if it isn't in one */
+    void* arena; /*!< Block holding the strings and the times of the splits */
+    long long* comparison_splits[LS_COMPARISON_COUNT]; /*!< Split times of each comparison, the PB ones are split_times */
+    long long* comparison_segments[LS_COMPARISON_COUNT]; /*!< Segment times of each comparison */
+    long long* comparison_data; /*!< Storage of the computed comparisons */
+    struct ls_stats* stats; /*!< Statistics of the attempt log, NULL if there are none */
 } ls_game;
 
 typedef struct ls_timer {
@@ -39,7 +73,14 @@ typedef struct ls_timer {
     long long now;
     long long start_time;
     long long time;
-    long long sum_of_bests;
+    ls_timing timing; /*!< The timing of time and the split times, game time once the run had a load or a game time */
+    long long timing_times[LS_TIMING_COUNT]; /*!< Current time in each timing */
+    long long* timing_splits[LS_TIMING_COUNT]; /*!< Split times of the splits done in each timing, zero if skipped */
+    long long* timing_segments[LS_TIMING_COUNT]; /*!< Segment times of the splits done in each timing */
+    long long* timing_deltas[LS_TIMING_COUNT]; /*!< Split deltas against the personal best in each timing */
+    long long* timing_data; /*!< Storage of the times of each timing */
+    long long sum_of_bests; /*!< Sum of the known best segments, use ls_timer_sum_of_bests */
+    int missing_best_segments; /*!< Number of segments without a best time */
     long long world_record;
     long long* split_times;
     long long* split_deltas;
@@ -48,6 +89,10 @@ typedef struct ls_timer {
     int* split_info;
     long long* best_splits;
     long long* best_segments;
+    long long* section_deltas; /*!< Time gained or lost in each section against the comparison */
+    ls_comparison comparison; /*!< The comparison the run is compared against */
+    const long long* comparison_splits; /*!< Split times of the comparison */
+    const long long* comparison_segments; /*!< Segment times of the comparison */
     const ls_game* game;
     int* attempt_count;
     int* finished_count;
@@ -59,6 +104,10 @@ long long ls_time_now(void);
 
 long long ls_time_value(const char* string);
 
+void ls_time_set_decimals(int decimals);
+
+int ls_time_decimals(void);
+
 void ls_time_string(char* string, long long time);
 
 void ls_time_millis_string(char* seconds, char* millis, long long time);
@@ -75,6 +124,8 @@ void ls_game_update_bests(const ls_game* game, const ls_timer* timer);
 
 bool ls_timer_has_gold_split(const ls_timer* timer);
 
+json_t* ls_game_to_json(const ls_game* game);
+
 int ls_game_save(const ls_game* game);
 
 void ls_game_release(const ls_game* game);
@@ -83,10 +134,18 @@ int ls_timer_create(ls_timer** timer_ptr, ls_game* game);
 
 void ls_timer_release(const ls_timer* timer);
 
+long long ls_timer_sum_of_bests(const ls_timer* timer);
+
+void ls_timer_set_comparison(ls_timer* timer, ls_comparison comparison);
+
 int ls_timer_start(ls_timer* timer);
 
 void ls_timer_step(ls_timer* timer, long long now);
 
+void ls_timer_set_loading(ls_timer* timer, bool loading);
+
+void ls_timer_set_game_time(ls_timer* timer, long long time);
+
 int ls_timer_split(ls_timer* timer);
 
 int ls_timer_skip(ls_timer* timer);